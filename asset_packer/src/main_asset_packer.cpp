@@ -0,0 +1,50 @@
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "core/vfs.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Packs every file under the asset directories into one archive. Paths are stored relative to base
+// directory, so they match the paths apps use when running from base directory.
+int main(int argCount, char **argv)
+{
+	if(argCount < 4)
+	{
+		printf("Usage: asset_packer <output file> <base directory> <asset directory>...\n");
+		return 1;
+	}
+
+	std::filesystem::path baseDirectory(argv[2]);
+	std::vector<core::AssetArchiveInput> files;
+	for(int i = 3; i < argCount; ++i)
+	{
+		std::error_code ec;
+		std::filesystem::path assetDirectory = baseDirectory / argv[i];
+		for(const auto &dirEntry : std::filesystem::recursive_directory_iterator(assetDirectory, ec))
+		{
+			if(!dirEntry.is_regular_file())
+				continue;
+
+			core::AssetArchiveInput input;
+			input.path = std::filesystem::relative(dirEntry.path(), baseDirectory).generic_string();
+			input.sourceFileName = dirEntry.path().string();
+			files.emplace_back(std::move(input));
+		}
+		if(ec)
+		{
+			printf("Failed to read asset directory: %s\n", assetDirectory.string().c_str());
+			return 1;
+		}
+	}
+
+	// Same input gives same archive.
+	std::sort(files.begin(), files.end(),
+		[](const core::AssetArchiveInput &a, const core::AssetArchiveInput &b) { return a.path < b.path; });
+
+	return core::writeAssetArchive(argv[1], files) ? 0 : 1;
+}
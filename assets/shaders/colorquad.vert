@@ -2,11 +2,15 @@
 
 layout (location = 0) uniform vec2 windowSize;
 
+// GPUQuad of QuadBatcher.
 struct VData
 {
 	vec2 vpos;
 	uint vSizes;
 	uint vColor;
+
+	vec2 vUvPos;
+	vec2 vUvSize;
 };
 
 layout (std430, binding=0) buffer shader_data
@@ -16,6 +20,7 @@ layout (std430, binding=0) buffer shader_data
 
 
 layout (location = 0) out vec4 colOut;
+layout (location = 1) out vec2 uvOut;
 void main()
 {
 	int quadId = gl_VertexID / 4;
@@ -31,6 +36,7 @@ void main()
 	vec2 p = vec2(-0.5f, -0.5f);
 	p.x = (vertId + 1) % 4 < 2 ? -0.5f : 0.5f;
 	p.y = vertId < 2 ? -0.5f : 0.5f;
+	uvOut = values[quadId].vUvPos + (p + 0.5f) * values[quadId].vUvSize;
 	vec2 vSize = vec2(float(values[quadId].vSizes & 0xffffu),
 		float((values[quadId].vSizes >> 16) & 0xffffu)); 
 	p *= vSize;
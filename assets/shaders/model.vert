@@ -1,4 +1,5 @@
 #version 450 core
+#extension GL_ARB_shader_draw_parameters : require
 
 layout (location = 0) uniform vec2 windowSize;
 
@@ -13,7 +14,7 @@ struct IData
 	uint iPos;
 	uint iSinCosRotationSize;
 	uint iColor;
-	uint iModelVertexStartIndex;
+	uint iMeshIndex;
 };
 
 /*
@@ -25,7 +26,7 @@ struct IData
 
 	uint iColor;
 	float iSize;
-	uint iModelVertexStartIndex;
+	uint iMeshIndex;
 	float iPadding;
 };
 */
@@ -45,12 +46,10 @@ layout (location = 0) out flat vec4 colOut;
 void main()
 {
 		
-	uint modelInstance = (gl_VertexID >> 8);
-	int indice = (gl_VertexID & 0xff);
-	//IData iData = instanceValues[modelInstance];
-	//VData vData = vertexValues[instanceValues[modelInstance].iModelVertexStartIndex + indice];
+	// Meshes come from the mesh registry, baseVertex is already added into gl_VertexID.
+	uint modelInstance = gl_BaseInstanceARB + gl_InstanceID;
 		
-	vec2 p = vertexValues[instanceValues[modelInstance].iModelVertexStartIndex + indice].vpos.xy;
+	vec2 p = vertexValues[gl_VertexID].vpos.xy;
 	//p *= instanceValues[modelInstance].iSize;
 	//float sv = instanceValues[modelInstance].iSinRotation; //sin(iData.iRotation);
 	//float cv = instanceValues[modelInstance].iCosRotation; //cos(iData.iRotation);
@@ -0,0 +1,33 @@
+#version 450 core
+
+layout(origin_upper_left) in vec4 gl_FragCoord;
+layout (location = 0) out vec4 outColor;
+
+layout (location = 0) in vec4 colIn;
+layout (location = 1) in vec2 uvIn;
+layout (location = 2) flat in uint letterIn;
+layout(depth_unchanged) out float gl_FragDepth;
+
+layout (binding = 0) uniform sampler2D sdfAtlas;
+
+// Glyph rect per atlas slot, x is texel position with 16 bits for x and y, y is size with 16 bits for
+// width and height.
+layout (std430, binding=3) buffer glyph_rects
+{
+	uvec2 glyphRects[];
+};
+
+void main()
+{
+	bool valid = letterIn < uint(glyphRects.length());
+	uvec2 rect = valid ? glyphRects[letterIn] : uvec2(0u);
+	vec2 glyphPos = vec2(rect.x & 0xffffu, rect.x >> 16u);
+	vec2 glyphSize = vec2(rect.y & 0xffffu, rect.y >> 16u);
+	vec2 texel = glyphPos + uvIn * glyphSize;
+	float dist = texture(sdfAtlas, texel / vec2(textureSize(sdfAtlas, 0))).r;
+
+	// Edge is about one screen pixel wide at any scale.
+	float edgeWidth = max(fwidth(dist) * 0.5f, 0.001f);
+	outColor.rgb = colIn.rgb;
+	outColor.a = valid ? smoothstep(0.5f - edgeWidth, 0.5f + edgeWidth, dist) : 0.0f;
+}
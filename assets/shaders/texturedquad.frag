@@ -5,14 +5,23 @@ layout (location = 0) out vec4 outColor;
 
 layout (location = 0) in vec4 colIn;
 layout (location = 1) in vec2 uvIn;
+layout (location = 2) flat in uint letterIn;
 layout(depth_unchanged) out float gl_FragDepth;
 	
-layout (binding = 0) uniform sampler2D ourTexture;
+// Raw font, 12 bytes per glyph, byte per row, bit x is column x.
+layout (std430, binding=1) buffer font_data
+{
+	uint fontBits[];
+};
 
 void main()
 {
-	outColor = texture(ourTexture, uvIn);
-	outColor.a = clamp(outColor.a / 0.5f, 0.0f, 1.0f);
+	uint x = min(uint(uvIn.x * 8.0f), 7u);
+	uint y = min(uint(uvIn.y * 12.0f), 11u);
+	uint byteIndex = letterIn * 12u + y;
+	uint row = letterIn < 96u ? (fontBits[byteIndex >> 2u] >> ((byteIndex & 3u) * 8u)) & 0xffu : 0u;
+
 	outColor.rgb = colIn.rgb;
+	outColor.a = float((row >> x) & 1u);
 
 }
\ No newline at end of file
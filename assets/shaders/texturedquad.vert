@@ -1,27 +1,39 @@
 #version 450 core
+#extension GL_ARB_shader_draw_parameters : require
 
 layout (location = 0) uniform vec2 windowSize;
 
-struct VData
+struct TextRun
 {
-	vec2 vpos;
-	uint vSizes;
-	uint vColor;
+	vec2 pos;
+	uint sizes;
+	uint color;
+
+	uint glyphStart;
+	uint length;
+	uint tmp0;
+	uint tmp1;
+};
 
-	vec2 vUv;
-	vec2 tmp;
+layout (std430, binding=0) buffer text_runs
+{
+	TextRun runs[];
 };
 
-layout (std430, binding=0) buffer shader_data
+// 16 bit glyph indices, 2 per uint.
+layout (std430, binding=2) buffer text_glyphs
 {
-	VData values[];
+	uint glyphs[];
 };
 
 
 layout (location = 0) out vec4 colOut;
 layout (location = 1) out vec2 uvOut;
+layout (location = 2) flat out uint letterOut;
 void main()
 {
+	// Block index comes in as base instance, gl_VertexID is index into whole glyph buffer.
+	TextRun run = runs[gl_BaseInstanceARB];
 	int quadId = gl_VertexID / 4;
 	int vertId = gl_VertexID % 4;
 
@@ -29,22 +41,23 @@ void main()
 	p.x = (vertId + 1) % 4 < 2 ? -0.5f : 0.5f;
 	p.y = vertId < 2 ? -0.5f : 0.5f;
 
+	// Uv is inside the glyph. Invalid glyph 0xffff gets skipped in fragment shader.
 	uvOut = p + 0.5f;
-		
-	uvOut.x = (uvOut.x) / (128.0f - 32.0f) + values[quadId].vUv.x;
+	letterOut = (glyphs[quadId >> 1] >> ((quadId & 1) * 16)) & 0xffffu;
 
-	vec2 vSize = vec2(float(values[quadId].vSizes & 0xffffu),
-		float((values[quadId].vSizes >> 16) & 0xffffu)); 
+	vec2 vSize = vec2(float(run.sizes & 0xffffu),
+		float((run.sizes >> 16) & 0xffffu));
 	p *= vSize;
-	p += values[quadId].vpos;
+	p += run.pos;
+	p.x += float(uint(quadId) - run.glyphStart) * vSize.x;
 	p /= windowSize * 0.5f;
 	p -= 1.0f;
-		
+
 	gl_Position = vec4(p.xy, 0.5, 1.0);
 	vec4 c = vec4(0, 0, 0, 0);
-	c.r = float((values[quadId].vColor >> 0u) & 255u) / 255.0f;
-	c.g = float((values[quadId].vColor >> 8u) & 255u) / 255.0f;
-	c.b = float((values[quadId].vColor >> 16u) & 255u) / 255.0f;
-	c.a = float((values[quadId].vColor >> 24u) & 255u) / 255.0f;
+	c.r = float((run.color >> 0u) & 255u) / 255.0f;
+	c.g = float((run.color >> 8u) & 255u) / 255.0f;
+	c.b = float((run.color >> 16u) & 255u) / 255.0f;
+	c.a = float((run.color >> 24u) & 255u) / 255.0f;
 	colOut = c;
-}
\ No newline at end of file
+}
@@ -0,0 +1,129 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+bool Bench::parseArguments(int argCount, char **argv)
+{
+	for(int i = 1; i < argCount; ++i)
+	{
+		if(strcmp(argv[i], "--sizes") == 0 && i + 1 < argCount)
+		{
+			options.sizes.clear();
+			const char *str = argv[++i];
+			while(*str)
+			{
+				char *end = nullptr;
+				uint64_t size = strtoull(str, &end, 10);
+				if(end == str || size == 0u || size > MaxBenchSize)
+				{
+					printf("Bad benchmark size in %s, sizes go from 1 to %u\n", argv[i], uint32_t(MaxBenchSize));
+					return false;
+				}
+				options.sizes.push_back(size);
+				str = *end == ',' ? end + 1 : end;
+			}
+		}
+		else if(strcmp(argv[i], "--warmup") == 0 && i + 1 < argCount)
+		{
+			options.warmup = uint32_t(atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "--repetitions") == 0 && i + 1 < argCount)
+		{
+			options.repetitions = uint32_t(atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "--filter") == 0 && i + 1 < argCount)
+		{
+			options.filter = argv[++i];
+		}
+		else if(strcmp(argv[i], "--json") == 0 && i + 1 < argCount)
+		{
+			options.jsonFileName = argv[++i];
+		}
+		else if(strcmp(argv[i], "--font") == 0 && i + 1 < argCount)
+		{
+			options.fontFileName = argv[++i];
+		}
+		else if(strcmp(argv[i], "--no-gl") == 0)
+		{
+			options.runGl = false;
+		}
+		else
+		{
+			printf("Unknown benchmark argument: %s\n", argv[i]);
+			return false;
+		}
+	}
+
+	if(options.sizes.empty() || options.repetitions == 0u)
+	{
+		printf("Benchmarks need at least one size and one repetition\n");
+		return false;
+	}
+	return true;
+}
+
+bool Bench::isEnabled(const char *name) const
+{
+	return options.filter.empty() || strstr(name, options.filter.c_str()) != nullptr;
+}
+
+void Bench::addResult(const char *name, uint64_t size, std::vector<double> &times)
+{
+	if(times.empty())
+		return;
+
+	std::sort(times.begin(), times.end());
+	BenchResult result{ .name = name, .size = size, .repetitions = uint32_t(times.size()), .minMs = times.front(),
+		.medianMs = times[ times.size() / 2 ], .maxMs = times.back(), .itemsPerSecond = 0.0 };
+	if(result.medianMs > 0.0)
+		result.itemsPerSecond = double(size) * 1000.0 / result.medianMs;
+	results.push_back(result);
+
+	printf("%-28s size: %9u, median: %10.4fms, min: %10.4fms, max: %10.4fms, %8.2fM items/s\n",
+		name, uint32_t(size), result.medianMs, result.minMs, result.maxMs, result.itemsPerSecond / 1000000.0);
+}
+
+bool Bench::writeJson(const std::string &fileName) const
+{
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if(!file)
+	{
+		printf("Failed to open %s for writing\n", fileName.c_str());
+		return false;
+	}
+
+#ifdef NDEBUG
+	const char *build = "release";
+#else
+	const char *build = "debug";
+#endif
+#if defined(__AVX2__)
+	const char *simd = "avx2";
+#elif defined(__x86_64__) || defined(_M_X64)
+	const char *simd = "sse2";
+#else
+	const char *simd = "scalar";
+#endif
+
+	// Benchmark names are plain identifiers, nothing needs escaping.
+	fprintf(file, "{\n\t\"build\": \"%s\",\n\t\"simd\": \"%s\",\n\t\"warmup\": %u,\n\t\"repetitions\": %u,\n\t\"results\": [\n",
+		build, simd, options.warmup, options.repetitions);
+	for(size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult &result = results[ i ];
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"size\": %llu, \"repetitions\": %u, \"minMs\": %.6f, \"medianMs\": %.6f, "
+			"\"maxMs\": %.6f, \"itemsPerSecond\": %.1f }%s\n",
+			result.name.c_str(), (unsigned long long)result.size, result.repetitions, result.minMs, result.medianMs,
+			result.maxMs, result.itemsPerSecond, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+
+	bool success = ferror(file) == 0;
+	fclose(file);
+	if(success)
+		printf("Wrote %u results into %s\n", uint32_t(results.size()), fileName.c_str());
+	return success;
+}
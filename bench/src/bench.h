@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Biggest size --sizes accepts.
+static constexpr uint64_t MaxBenchSize = 10000000u;
+
+// Times of one benchmark at one size, every time is for one repetition.
+struct BenchResult
+{
+	std::string name;
+	uint64_t size;
+	uint32_t repetitions;
+	double minMs;
+	double medianMs;
+	double maxMs;
+	// Size divided by median time.
+	double itemsPerSecond;
+};
+
+struct BenchOptions
+{
+	std::vector<uint64_t> sizes = { 1000u, 100000u, 1000000u };
+	uint32_t warmup = 2u;
+	uint32_t repetitions = 10u;
+	// Only benchmarks whose name contains filter run, empty runs all.
+	std::string filter;
+	std::string jsonFileName;
+	std::string fontFileName = "assets/font/new_font.dat";
+	bool runGl = true;
+};
+
+class Bench
+{
+public:
+	// --sizes <n,n,...>    item counts for the benchmarks that scale, 1 to 10M, defaults to 1k,100k,1M.
+	// --warmup <count>     untimed runs before the timed ones, defaults to 2.
+	// --repetitions <count> timed runs, results have min, median and max of them, defaults to 10.
+	// --filter <text>      only run benchmarks with text in their name.
+	// --json <file>        write results as json, for tracking them over time.
+	// --font <file>        font for the font and glyph benchmarks, defaults to assets/font/new_font.dat.
+	// --no-gl              skip the benchmarks that need gl context.
+	bool parseArguments(int argCount, char **argv);
+
+	bool isEnabled(const char *name) const;
+
+	// Runs func warmup + repetitions times, times only the repetitions. func returns a checksum of what it
+	// computed, so the compiler can't drop the work.
+	template <typename Func>
+	void run(const char *name, uint64_t size, const Func &func)
+	{
+		if(!isEnabled(name))
+			return;
+
+		for(uint32_t i = 0; i < options.warmup; ++i)
+			checksum += uint64_t(func());
+
+		std::vector<double> times(options.repetitions);
+		for(double &time : times)
+		{
+			auto startTime = std::chrono::high_resolution_clock::now();
+			checksum += uint64_t(func());
+			time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		}
+		addResult(name, size, times);
+	}
+
+	// For benchmarks that time themselves, times in ms.
+	void addResult(const char *name, uint64_t size, std::vector<double> &times);
+
+	bool writeJson(const std::string &fileName) const;
+
+	BenchOptions options;
+	std::vector<BenchResult> results;
+	// Printed at the end, only there to keep the work alive.
+	uint64_t checksum = 0u;
+};
+
+// Every suite runs its benchmarks for each of bench.options.sizes, unless the benchmark has a natural size,
+// like the glyph count of the font. Returns false if a result check fails.
+bool runCpuBenches(Bench &bench);
+bool runBroadPhaseBenches(Bench &bench);
+// Needs gl 4.5 context current on the calling thread.
+bool runGlBenches(Bench &bench);
@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "bench.h"
+
+#include "core/broadphase.h"
+
+#include <cmath>
+#include <vector>
+
+// Same density as space_shooter: 1000 asteroids in 2000x1200 area, radius between 5 and 15.
+static constexpr float AreaPerEntity = 2000.0f * 1200.0f / 1000.0f;
+static constexpr float MaxRadius = 15.0f;
+
+static uint64_t countBruteForcePairs(const std::vector<float> &x, const std::vector<float> &y,
+	const std::vector<float> &r, float worldWidth, float worldHeight)
+{
+	uint64_t pairs = 0u;
+	for(size_t i = 0; i < x.size(); ++i)
+	{
+		for(size_t j = i + 1; j < x.size(); ++j)
+		{
+			float dx = fabsf(x[ j ] - x[ i ]);
+			float dy = fabsf(y[ j ] - y[ i ]);
+			dx = fminf(dx, worldWidth - dx);
+			dy = fminf(dy, worldHeight - dy);
+			float rr = r[ i ] + r[ j ];
+			if(dx * dx + dy * dy < rr * rr)
+				++pairs;
+		}
+	}
+	return pairs;
+}
+
+bool runBroadPhaseBenches(Bench &bench)
+{
+	for(uint64_t size : bench.options.sizes)
+	{
+		uint32_t count = uint32_t(size);
+		// Keep density constant, world has same aspect as space_shooter.
+		float worldHeight = sqrtf(AreaPerEntity * float(count) * 1200.0f / 2000.0f);
+		float worldWidth = worldHeight * 2000.0f / 1200.0f;
+
+		srand(100);
+		std::vector<float> x(count), y(count), r(count);
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			x[ i ] = float(rand()) / float(RAND_MAX) * worldWidth;
+			y[ i ] = float(rand()) / float(RAND_MAX) * worldHeight;
+			r[ i ] = 5.0f + (MaxRadius - 5.0f) * float(rand()) / float(RAND_MAX);
+		}
+
+		core::UniformGrid grid;
+		std::vector<core::BroadPhasePair> pairs;
+		grid.build(x.data(), y.data(), r.data(), count, worldWidth, worldHeight, MaxRadius * 2.0f);
+		grid.findPairs(pairs);
+
+		bench.run("broadphase_rebuild", size, [&]()
+		{
+			grid.build(x.data(), y.data(), r.data(), count, worldWidth, worldHeight, MaxRadius * 2.0f);
+			return grid.gridWidth;
+		});
+		bench.run("broadphase_query", size, [&]()
+		{
+			pairs.clear();
+			grid.findPairs(pairs);
+			return pairs.size();
+		});
+
+		// Brute force is quadratic, only small sizes get checked.
+		if(count <= 1000u && bench.isEnabled("broadphase"))
+		{
+			uint64_t bruteForcePairs = countBruteForcePairs(x, y, r, worldWidth, worldHeight);
+			if(bruteForcePairs != pairs.size())
+			{
+				printf("Broad phase pair count mismatch, grid: %u, brute force: %u\n", uint32_t(pairs.size()),
+					uint32_t(bruteForcePairs));
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,415 @@
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "bench.h"
+
+#include "core/app.h"
+#include "core/fontfile.h"
+#include "core/jobsystem.h"
+#include "core/sdfbaker.h"
+
+#include "../../space_shooter/src/entities.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+static bool readFile(const std::string &fileName, std::vector<uint8_t> &outData)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	if(!file)
+		return false;
+	outData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+static void runColorBenches(Bench &bench)
+{
+	for(uint64_t size : bench.options.sizes)
+	{
+		uint32_t count = uint32_t(size);
+		bench.run("get_color", size, [count]()
+		{
+			float step = 1.0f / float(count);
+			uint32_t result = 0u;
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				float f = float(i) * step;
+				result ^= core::getColor(f, 1.0f - f, f * 0.5f, 1.0f);
+			}
+			return result;
+		});
+	}
+}
+
+// Compares the simd packing against the scalar one field by field. Position and size have to match, sin and
+// cos can be one quantization step off from the polynomial approximation. Returns mismatch count.
+static uint32_t comparePacking(const EntityArrays &entities, const InterpolationParams &params)
+{
+	uint32_t count = entities.getCount();
+	std::vector<GpuModelInstance> simd(count);
+	std::vector<GpuModelInstance> scalar(count);
+	packModelInstances(entities, 0u, count, params, simd.data());
+	packModelInstancesScalar(entities, 0u, count, params, scalar.data());
+
+	uint32_t mismatches = 0u;
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		const GpuModelInstance &a = simd[ i ];
+		const GpuModelInstance &b = scalar[ i ];
+		int sinDiff = abs(int((a.sinCosRotSize >> 10u) & 1023u) - int((b.sinCosRotSize >> 10u) & 1023u));
+		int cosDiff = abs(int(a.sinCosRotSize >> 20u) - int(b.sinCosRotSize >> 20u));
+		if(a.pos == b.pos && (a.sinCosRotSize & 1023u) == (b.sinCosRotSize & 1023u) && sinDiff <= 1 && cosDiff <= 1
+			&& a.color == b.color && a.meshIndex == b.meshIndex)
+			continue;
+
+		if(++mismatches <= 8u)
+		{
+			printf("Packing mismatch at %u, rotation: %.9g, size: %.9g, simd: %08x %08x, scalar: %08x %08x\n", i,
+				entities.rotation[ i ], entities.size[ i ], a.pos, a.sinCosRotSize, b.pos, b.sinCosRotSize);
+		}
+	}
+	return mismatches;
+}
+
+static bool checkPacking()
+{
+	// Packing maps [0, 2048) into 16 bits per axis.
+	InterpolationParams params{ .alpha = 0.5f, .wrapWidth = 2048.0f, .wrapHeight = 2048.0f };
+
+	// Edge cases have prev == current, so interpolation leaves the values as they are.
+	EntityArrays edges;
+	auto addEdge = [&edges](float pos, float rotation, float size)
+	{
+		uint32_t index = edges.getCount();
+		edges.add(Entity{ .posX = pos, .posY = 2047.999f - pos, .posZ = 0.5f, .rotation = rotation, .speedX = 0.0f,
+			.speedY = 0.0f, .size = size, .rotationSpeed = 0.0f }, index * 2654435761u, index);
+	};
+
+	// Rotations at and right next to the quadrant boundaries, where the sincos range reduction switches.
+	const float offsets[] = { 0.0f, 1.0e-6f, -1.0e-6f, 1.0e-3f, -1.0e-3f, 0.7853981f, -0.7853981f };
+	for(int quadrant = -16; quadrant <= 16; ++quadrant)
+	{
+		for(float offset : offsets)
+		{
+			float rotation = float(quadrant) * float(M_PI * 0.5) + offset;
+			addEdge(float(quadrant + 16) * 60.0f, rotation, 10.0f);
+			addEdge(float(quadrant + 16) * 60.0f, nextafterf(rotation, 100.0f), 10.0f);
+		}
+	}
+
+	// Values right at, above and below the 16 bit position and 10 bit size quantization steps.
+	for(uint32_t step = 0; step <= 64u; ++step)
+	{
+		float pos = fminf(float(step) * 32.0f, 2047.999f);
+		float quantPos = float(step * 1023u) * 2048.0f / 65535.0f;
+		float quantSize = float(step * 15u) * 64.0f / 1023.0f;
+		addEdge(pos, 0.0f, fminf(quantSize, 63.99f));
+		addEdge(quantPos, 0.5f, nextafterf(quantSize, 0.0f));
+		addEdge(nextafterf(quantPos, 0.0f), 1.0f, nextafterf(quantSize, 64.0f));
+		addEdge(nextafterf(quantPos, 2048.0f), 2.0f, 0.0f);
+	}
+	addEdge(0.0f, 0.0f, 0.0f);
+	addEdge(2047.999f, 3.0f, 63.999f);
+	// Odd count, so the scalar tail after the simd batches gets compared too.
+	if(edges.getCount() % 2u == 0u)
+		addEdge(1.0f, 1.0f, 1.0f);
+
+	srand(200);
+	EntityArrays randoms;
+	for(uint32_t i = 0; i < 10001u; ++i)
+	{
+		float posX = float(rand()) / float(RAND_MAX) * 2047.0f;
+		float posY = float(rand()) / float(RAND_MAX) * 2047.0f;
+		randoms.add(Entity{ .posX = posX, .posY = posY, .posZ = 0.5f,
+			.rotation = (float(rand()) / float(RAND_MAX) * 2.0f - 1.0f) * 50.0f, .speedX = 0.0f, .speedY = 0.0f,
+			.size = float(rand()) / float(RAND_MAX) * 63.0f, .rotationSpeed = 0.0f }, uint32_t(rand()), i % 32u);
+		// Some move over the wrap edge between the steps.
+		randoms.prevPosX[ i ] = i % 7u == 0u ? fmodf(posX + 2040.0f, 2048.0f) : posX - 1.0f;
+		randoms.prevPosY[ i ] = posY;
+		randoms.prevRotation[ i ] = randoms.rotation[ i ] + 0.1f;
+	}
+
+	uint32_t mismatches = comparePacking(edges, params) + comparePacking(randoms, params);
+	if(mismatches > 0u)
+	{
+		printf("Simd packing differs from scalar in %u instances\n", mismatches);
+		return false;
+	}
+	printf("Simd packing matches scalar, %u instances checked\n", edges.getCount() + randoms.getCount());
+	return true;
+}
+
+static bool runPackingBenches(Bench &bench)
+{
+	if(!bench.isEnabled("pack_instances"))
+		return true;
+
+	if(!checkPacking())
+		return false;
+
+	for(uint64_t size : bench.options.sizes)
+	{
+		uint32_t count = uint32_t(size);
+		// Packing maps [0, 2048) into 16 bits per axis.
+		InterpolationParams params{ .alpha = 0.5f, .wrapWidth = 2048.0f, .wrapHeight = 2048.0f };
+
+		srand(100);
+		EntityArrays entities;
+		entities.reserve(count);
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			float posX = float(rand()) / float(RAND_MAX) * params.wrapWidth;
+			float posY = float(rand()) / float(RAND_MAX) * params.wrapHeight;
+			entities.add(Entity{ .posX = posX, .posY = posY, .posZ = 0.5f, .rotation = float(rand()) / float(RAND_MAX) * 6.28f,
+				.speedX = 0.0f, .speedY = 0.0f, .size = 5.0f + float(i % 11u), .rotationSpeed = 0.0f }, ~0u, i % 32u);
+			entities.prevPosX[ i ] = posX - 1.0f;
+			entities.prevPosY[ i ] = posY + 1.0f;
+		}
+		std::vector<GpuModelInstance> instances(count);
+
+		bench.run("pack_instances", size, [&]()
+		{
+			packModelInstances(entities, 0u, count, params, instances.data());
+			return instances[ count / 2u ].pos;
+		});
+		bench.run("pack_instances_scalar", size, [&]()
+		{
+			packModelInstancesScalar(entities, 0u, count, params, instances.data());
+			return instances[ count / 2u ].pos;
+		});
+	}
+	return true;
+}
+
+// Asteroid field laid out like space_shooter: shapes own contiguous entity ranges, and every LOD level has room
+// for all entities, shape ranges inside it.
+struct ModelFrame
+{
+	static constexpr uint32_t ShapeCount = 8u;
+
+	ModelFrame(uint32_t count) : visibleIndices(count), packedInstances(count),
+		outInstances(size_t(count) * AsteroidLodCount), baseInstances(ShapeCount * AsteroidLodCount),
+		instanceCounts(ShapeCount * AsteroidLodCount)
+	{
+		srand(300);
+		entities.reserve(count);
+		for(uint32_t shape = 0u; shape < ShapeCount; ++shape)
+		{
+			uint32_t start = uint32_t(uint64_t(shape) * count / ShapeCount);
+			uint32_t end = uint32_t(uint64_t(shape + 1u) * count / ShapeCount);
+			for(uint32_t lod = 0u; lod < AsteroidLodCount; ++lod)
+				baseInstances[ shape * AsteroidLodCount + lod ] = lod * count + start;
+
+			for(uint32_t i = start; i < end; ++i)
+			{
+				entities.add(Entity{ .posX = float(rand()) / float(RAND_MAX) * 2000.0f,
+					.posY = float(rand()) / float(RAND_MAX) * 1200.0f, .posZ = 0.5f, .rotation = 0.0f,
+					.speedX = 20.0f * (float(rand()) / float(RAND_MAX) * 2.0f - 1.0f),
+					.speedY = 20.0f * (float(rand()) / float(RAND_MAX) * 2.0f - 1.0f),
+					.size = 2.0f + 13.0f * float(rand()) / float(RAND_MAX),
+					.rotationSpeed = float(rand()) / float(RAND_MAX) * 2.0f - 1.0f },
+					~0u, shape * AsteroidLodCount);
+			}
+		}
+		buckets = MeshInstanceBuckets{ .baseInstances = baseInstances.data(), .instanceCounts = instanceCounts.data(),
+			.meshCount = ShapeCount * AsteroidLodCount };
+		params = ModelFrameParams{ .stepDt = 1.0f / 100.0f, .stepCount = 2u, .wrapWidth = 2000.0f,
+			.wrapHeight = 1200.0f, .interpolation = InterpolationParams{ .alpha = 0.5f, .wrapWidth = 2000.0f,
+			.wrapHeight = 1200.0f }, .cullRect = CullRect{ .minX = 0.0f, .minY = 0.0f, .maxX = 1000.0f,
+			.maxY = 600.0f }, .pixelsPerUnit = 1.0f, .visibleIndices = visibleIndices.data(),
+			.packedInstances = packedInstances.data(), .buckets = &buckets, .outInstances = outInstances.data() };
+	}
+
+	// batchSize 0 runs the whole range in one call on this thread.
+	uint32_t update(core::JobSystem &jobSystem, uint32_t batchSize)
+	{
+		for(std::atomic<uint32_t> &instanceCount : instanceCounts)
+			instanceCount = 0u;
+
+		uint32_t count = entities.getCount();
+		if(batchSize == 0u)
+			return updateModelBatch(entities, 0u, count, params);
+
+		std::atomic<uint32_t> visibleCount = 0u;
+		jobSystem.parallelFor(count, batchSize, [&](uint32_t start, uint32_t end)
+		{
+			visibleCount += updateModelBatch(entities, start, end, params);
+		});
+		return visibleCount;
+	}
+
+	EntityArrays entities;
+	std::vector<uint32_t> visibleIndices;
+	std::vector<GpuModelInstance> packedInstances;
+	std::vector<GpuModelInstance> outInstances;
+	std::vector<uint32_t> baseInstances;
+	std::vector<std::atomic<uint32_t>> instanceCounts;
+	MeshInstanceBuckets buckets;
+	ModelFrameParams params;
+};
+
+static bool sameFloats(const std::vector<float> &a, const std::vector<float> &b)
+{
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+// Runs frames single threaded and on the job system from the same start, the entities and packed instances
+// have to come out bit for bit the same. Order inside a mesh range depends on thread timing, so those get
+// compared sorted.
+static bool checkModelUpdate(core::JobSystem &jobSystem, uint32_t count, uint32_t batchSize)
+{
+	ModelFrame single(count);
+	ModelFrame jobs(count);
+	for(uint32_t frame = 0; frame < 4u; ++frame)
+	{
+		uint32_t singleVisible = single.update(jobSystem, 0u);
+		uint32_t jobsVisible = jobs.update(jobSystem, batchSize);
+
+		bool same = singleVisible == jobsVisible;
+		const EntityArrays &a = single.entities;
+		const EntityArrays &b = jobs.entities;
+		same = same && sameFloats(a.posX, b.posX) && sameFloats(a.posY, b.posY) && sameFloats(a.rotation, b.rotation)
+			&& sameFloats(a.prevPosX, b.prevPosX) && sameFloats(a.prevPosY, b.prevPosY)
+			&& sameFloats(a.prevRotation, b.prevRotation);
+		same = same && memcmp(single.packedInstances.data(), jobs.packedInstances.data(),
+			count * sizeof(GpuModelInstance)) == 0;
+
+		for(uint32_t mesh = 0; mesh < single.buckets.meshCount && same; ++mesh)
+		{
+			uint32_t meshCount = single.instanceCounts[ mesh ];
+			same = meshCount == jobs.instanceCounts[ mesh ];
+			GpuModelInstance *singleRange = single.outInstances.data() + single.baseInstances[ mesh ];
+			GpuModelInstance *jobsRange = jobs.outInstances.data() + jobs.baseInstances[ mesh ];
+			auto less = [](const GpuModelInstance &x, const GpuModelInstance &y) { return x.pos < y.pos; };
+			std::sort(singleRange, singleRange + meshCount, less);
+			std::sort(jobsRange, jobsRange + meshCount, less);
+			same = same && memcmp(singleRange, jobsRange, meshCount * sizeof(GpuModelInstance)) == 0;
+		}
+
+		if(!same)
+		{
+			printf("Job system model update differs from single threaded one, %u entities, frame %u\n", count, frame);
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool runModelUpdateBenches(Bench &bench)
+{
+	if(!bench.isEnabled("model_update"))
+		return true;
+
+	// Batch size space_shooter uses. More workers than cores is fine, it only has to run on other threads.
+	static constexpr uint32_t BatchSize = 128u;
+	core::JobSystem jobSystem;
+	jobSystem.init(std::thread::hardware_concurrency() > 3u ? 0u : 3u);
+
+	for(uint64_t size : bench.options.sizes)
+	{
+		uint32_t count = uint32_t(size);
+		if(!checkModelUpdate(jobSystem, count, BatchSize))
+			return false;
+
+		ModelFrame frame(count);
+		bench.run("model_update", size, [&]()
+		{
+			return frame.update(jobSystem, 0u);
+		});
+		bench.run("model_update_jobs", size, [&]()
+		{
+			return frame.update(jobSystem, BatchSize);
+		});
+	}
+	return true;
+}
+
+static bool runFontBenches(Bench &bench)
+{
+	const BenchOptions &options = bench.options;
+
+	std::vector<uint8_t> fontData;
+	if(!readFile(options.fontFileName, fontData))
+	{
+		printf("No font %s, skipping font benchmarks\n", options.fontFileName.c_str());
+		return true;
+	}
+
+	core::FontFile font;
+	bench.run("font_open_mapped", fontData.size(), [&]()
+	{
+		font.open(options.fontFileName);
+		return font.size;
+	});
+	bench.run("font_open_memory", fontData.size(), [&]()
+	{
+		font.open(std::span<const uint8_t>(fontData.data(), fontData.size()));
+		return font.size;
+	});
+
+	if(!font.open(std::span<const uint8_t>(fontData.data(), fontData.size())) || font.getSizeCount() == 0u)
+	{
+		printf("Failed to open font %s\n", options.fontFileName.c_str());
+		return false;
+	}
+
+	// Old headerless files are the 8x12 glyph data alone, they get converted on every open.
+	uint32_t oldSizeIndex = font.findSize(8u, 12u);
+	if(oldSizeIndex != ~0u)
+	{
+		std::vector<uint8_t> oldFontData(font.getGlyphData(oldSizeIndex),
+			font.getGlyphData(oldSizeIndex) + font.getGlyphDataSize(oldSizeIndex));
+		core::FontFile oldFont;
+		bench.run("font_open_convert", oldFontData.size(), [&]()
+		{
+			oldFont.open(std::span<const uint8_t>(oldFontData.data(), oldFontData.size()));
+			return oldFont.size;
+		});
+	}
+
+	// Size is the glyph count of the biggest size, that is the slowest one to bake.
+	uint32_t sizeIndex = 0u;
+	for(uint32_t i = 1; i < font.getSizeCount(); ++i)
+	{
+		if(font.getSize(i).glyphWidth * font.getSize(i).glyphHeight >
+			font.getSize(sizeIndex).glyphWidth * font.getSize(sizeIndex).glyphHeight)
+			sizeIndex = i;
+	}
+	const core::FontSizeInfo &sizeInfo = font.getSize(sizeIndex);
+	uint32_t glyphCount = uint32_t(sizeInfo.lastChar - sizeInfo.firstChar) + 1u;
+
+	core::SdfBakeParams params;
+	core::SdfAtlas atlas;
+	bench.run("sdf_bake", glyphCount, [&]()
+	{
+		core::bakeSdfAtlas(font, sizeIndex, params, nullptr, atlas);
+		return atlas.texels[ atlas.texels.size() / 2u ];
+	});
+
+	if(bench.isEnabled("sdf_bake_jobs"))
+	{
+		core::JobSystem jobSystem;
+		jobSystem.init();
+		bench.run("sdf_bake_jobs", glyphCount, [&]()
+		{
+			core::bakeSdfAtlas(font, sizeIndex, params, &jobSystem, atlas);
+			return atlas.texels[ atlas.texels.size() / 2u ];
+		});
+	}
+	return true;
+}
+
+bool runCpuBenches(Bench &bench)
+{
+	runColorBenches(bench);
+	bool success = runPackingBenches(bench);
+	success = runModelUpdateBenches(bench) && success;
+	return runFontBenches(bench) && success;
+}
@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+#include "bench.h"
+
+#include "glad/glad.h"
+
+#include "core/fontfile.h"
+
+#include "ogl/glyphatlas.h"
+#include "ogl/shaderbuffer.h"
+#include "ogl/textbuffer.h"
+
+#include "../../space_shooter/src/entities.h"
+
+#include <string>
+#include <vector>
+
+// Every strategy uploads size instances, the way space_shooter sends its instances each frame. glFinish at
+// the end of every repetition, so driver side copies that got deferred are part of the time.
+static void runUploadBenches(Bench &bench)
+{
+	for(uint64_t size : bench.options.sizes)
+	{
+		uint32_t bytes = uint32_t(size) * uint32_t(sizeof(GpuModelInstance));
+		std::vector<GpuModelInstance> instances(size);
+		for(uint32_t i = 0; i < uint32_t(size); ++i)
+			instances[ i ] = GpuModelInstance{ .pos = i, .sinCosRotSize = i * 3u, .color = ~0u, .meshIndex = i % 32u };
+
+		if(bench.isEnabled("upload_subdata"))
+		{
+			ShaderBuffer buffer(GL_SHADER_STORAGE_BUFFER, bytes, GL_DYNAMIC_DRAW);
+			bench.run("upload_subdata", size, [&]()
+			{
+				buffer.updateBuffer(0u, bytes, instances.data());
+				glFinish();
+				return bytes;
+			});
+		}
+
+		if(bench.isEnabled("upload_orphan"))
+		{
+			// New storage every time, driver doesn't have to wait for draws still reading the old one.
+			ShaderBuffer buffer(GL_SHADER_STORAGE_BUFFER, bytes, GL_STREAM_DRAW);
+			bench.run("upload_orphan", size, [&]()
+			{
+				glNamedBufferData(buffer.handle, bytes, nullptr, GL_STREAM_DRAW);
+				buffer.updateBuffer(0u, bytes, instances.data());
+				glFinish();
+				return bytes;
+			});
+		}
+
+		if(bench.isEnabled("upload_immutable"))
+		{
+			ShaderBuffer buffer(GL_SHADER_STORAGE_BUFFER, bytes, GL_DYNAMIC_STORAGE_BIT, nullptr, true);
+			bench.run("upload_immutable", size, [&]()
+			{
+				buffer.updateBuffer(0u, bytes, instances.data());
+				glFinish();
+				return bytes;
+			});
+		}
+
+		if(bench.isEnabled("upload_streaming"))
+		{
+			ShaderBuffer buffer(GL_SHADER_STORAGE_BUFFER, bytes, 0, nullptr, false, 3u);
+			bench.run("upload_streaming", size, [&]()
+			{
+				unsigned int offset = 0u;
+				memcpy(buffer.allocate(bytes, offset), instances.data(), bytes);
+				buffer.endFrame();
+				glFinish();
+				return offset;
+			});
+		}
+	}
+}
+
+static void runTextBenches(Bench &bench)
+{
+	if(!bench.isEnabled("text_"))
+		return;
+
+	for(uint64_t size : bench.options.sizes)
+	{
+		uint32_t count = uint32_t(size);
+		// Without glyph atlas glyphs are code point - 32, every glyph differs between the two texts.
+		std::string texts[ 2 ];
+		texts[ 0 ].resize(count);
+		texts[ 1 ].resize(count);
+		for(uint32_t i = 0; i < count; ++i)
+		{
+			texts[ 0 ][ i ] = char('a' + i % 26u);
+			texts[ 1 ][ i ] = char('A' + i % 26u);
+		}
+
+		TextBuffer textBuffer(count, 1u);
+		uint32_t block = textBuffer.addBlock(count, 100.0f, 100.0f, ~0u);
+		textBuffer.setText(block, texts[ 0 ]);
+		textBuffer.upload();
+
+		uint32_t textIndex = 0u;
+		bench.run("text_set_all", size, [&]()
+		{
+			textIndex ^= 1u;
+			textBuffer.setText(block, texts[ textIndex ]);
+			uint32_t uploaded = textBuffer.upload();
+			glFinish();
+			return uploaded;
+		});
+
+		// Typing one character, with the metrics update font_render does every time.
+		std::string &text = texts[ textIndex ];
+		bench.run("text_edit_one", size, [&]()
+		{
+			text[ count / 2u ] = text[ count / 2u ] == '#' ? '$' : '#';
+			textBuffer.setText(block, text);
+			textBuffer.setMetrics(block, 100.0f, 100.0f, 8, 12);
+			uint32_t uploaded = textBuffer.upload();
+			glFinish();
+			return uploaded;
+		});
+	}
+}
+
+static bool runGlyphAtlasBenches(Bench &bench)
+{
+	if(!bench.isEnabled("glyph_atlas"))
+		return true;
+
+	core::FontFile font;
+	if(!font.open(bench.options.fontFileName) || font.getSizeCount() == 0u)
+	{
+		printf("No font %s, skipping glyph atlas benchmarks\n", bench.options.fontFileName.c_str());
+		return true;
+	}
+
+	const core::FontSizeInfo &sizeInfo = font.getSize(0u);
+	uint32_t glyphCount = uint32_t(sizeInfo.lastChar - sizeInfo.firstChar) + 1u;
+
+	// Every glyph misses, gets baked and uploaded into a new atlas.
+	bench.run("glyph_atlas_miss", glyphCount, [&]()
+	{
+		GlyphAtlas atlas(font, 1024u, 1024u, 1024u);
+		for(uint32_t codePoint = sizeInfo.firstChar; codePoint <= sizeInfo.lastChar; ++codePoint)
+			atlas.acquire(0u, codePoint);
+		glFinish();
+		return atlas.missCount;
+	});
+
+	GlyphAtlas atlas(font, 1024u, 1024u, 1024u);
+	for(uint32_t codePoint = sizeInfo.firstChar; codePoint <= sizeInfo.lastChar; ++codePoint)
+		atlas.release(atlas.acquire(0u, codePoint));
+	bench.run("glyph_atlas_hit", glyphCount, [&]()
+	{
+		uint32_t slots = 0u;
+		for(uint32_t codePoint = sizeInfo.firstChar; codePoint <= sizeInfo.lastChar; ++codePoint)
+		{
+			uint32_t slot = atlas.acquire(0u, codePoint);
+			atlas.release(slot);
+			slots += slot;
+		}
+		return slots;
+	});
+	return true;
+}
+
+bool runGlBenches(Bench &bench)
+{
+	runUploadBenches(bench);
+	runTextBenches(bench);
+	return runGlyphAtlasBenches(bench);
+}
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "bench.h"
+
+#include "core/app.h"
+
+// Hot path benchmarks. Cpu ones first, then the gl ones on a headless context, with Mesa and no gpu that
+// is llvmpipe: LIBGL_ALWAYS_SOFTWARE=1 ./hellogl_bench --json results.json
+int main(int argCount, char **argv)
+{
+	core::App app;
+	// Gl benchmarks never show anything, and without benchmarkFrames the app would ask for a debug context.
+	app.headless = true;
+	app.benchmarkFrames = 1u;
+	argCount = app.parseArguments(argCount, argv);
+
+	Bench bench;
+	if(!bench.parseArguments(argCount, argv))
+		return 1;
+
+	bool success = runCpuBenches(bench);
+	success = runBroadPhaseBenches(bench) && success;
+
+	if(bench.options.runGl)
+	{
+		if(app.init("hellogl_bench", 640, 480))
+			success = runGlBenches(bench) && success;
+		else
+			printf("No gl context, skipping gl benchmarks\n");
+	}
+
+	printf("Checksum: %llu\n", (unsigned long long)bench.checksum);
+	if(!bench.options.jsonFileName.empty())
+		success = bench.writeJson(bench.options.jsonFileName) && success;
+	return success ? 0 : 1;
+}
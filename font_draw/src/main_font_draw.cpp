@@ -5,51 +5,50 @@
 #include "glad/glad.h"
 #include <SDL2/SDL.h>
 
+#include "core/allocationcounter.h"
 #include "core/app.h"
-
+#include "core/fontfile.h"
+#include "core/framearena.h"
+#include "core/renderthread.h"
+
+#include "ogl/fontbuffer.h"
+#include "ogl/glstatecache.h"
+#include "ogl/quadbatcher.h"
+#include "ogl/rendercommandbuffer.h"
 #include "ogl/shader.h"
-#include "ogl/shaderbuffer.h"
+#include "ogl/textbuffer.h"
 
+#include <cstring>
 #include <vector>
-#include <filesystem>
-#include <fstream>
 
 static constexpr int SCREEN_WIDTH  = 640;
 static constexpr int SCREEN_HEIGHT = 540;
 
-struct GPUVertexData
+// Font preview on top of the window, every glyph of the font in lines of PreviewLineLength.
+static constexpr uint32_t PreviewLineLength = 32u;
+static constexpr uint32_t PreviewLines = FontBuffer::GlyphCount / PreviewLineLength;
+
+struct GlyphEdit
 {
-	float posX;
-	float posY;
-	uint16_t pixelSizeX;
-	uint16_t pixelSizeY;
-	uint32_t color;
+	uint32_t letter;
+	uint8_t bytes[ FontBuffer::GlyphBytes ];
 };
 
-
-
-bool saveFontData(const std::string &filename, const std::vector<char> &data)
+// Everything the render thread needs for a frame.
+struct FramePacket
 {
-	//
-	if(std::filesystem::exists(filename))
-	{
-		std::filesystem::path p(filename);
-
-
-		std::ofstream f(p, std::ios::out | std::ios::binary);
-
-
-		f.write(data.data(), data.size());
-
-		printf("filesize: %u\n", uint32_t(data.size()));
-		return true;
-	}
-	return false;
-}
-
+	std::vector<GPUQuad> quads;
+	// Glyphs that changed since the last packet, only these get uploaded into the font buffer.
+	std::vector<GlyphEdit> glyphEdits;
+	int windowWidth = 0;
+	int windowHeight = 0;
+};
 
-static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string &filename)
+static void mainProgramLoop(core::App &app, core::FontFile &font, uint32_t fontSize, std::string &filename)
 {
+	// Edits go straight into the copy on write mapping of the font file.
+	uint8_t *data = font.getGlyph(fontSize, 32u);
+
 	Shader shader;
 	if (!shader.initShader("assets/shaders/colorquad.vert", "assets/shaders/colorquad.frag"))
 	{
@@ -57,40 +56,44 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 		return;
 	}
 
-	ShaderBuffer ssbo(GL_SHADER_STORAGE_BUFFER, 10240u * 16u, GL_DYNAMIC_COPY, nullptr);
-	
-	uint32_t chosenLetter = 'a';
-	//uint32_t lastTicks = SDL_GetTicks();
-
-	std::vector<uint32_t> indices;
-	indices.resize(6 * 10240);
-	for(int i = 0; i < 10240; ++i)
+	Shader textShader;
+	if (!textShader.initShader("assets/shaders/texturedquad.vert", "assets/shaders/texturedquad.frag"))
 	{
-		indices[size_t(i) * 6 + 0] = i * 4 + 0;
-		indices[size_t(i) * 6 + 1] = i * 4 + 1;
-		indices[size_t(i) * 6 + 2] = i * 4 + 2;
-
-		indices[size_t(i) * 6 + 3] = i * 4 + 0;
-		indices[size_t(i) * 6 + 4] = i * 4 + 2;
-		indices[size_t(i) * 6 + 5] = i * 4 + 3;
+		printf("Failed to init text shader\n");
+		return;
 	}
 
+	// Preview draws with the bit font shader straight from the font bytes, so an edit is one 12 byte glyph
+	// upload instead of the whole font.
+	FontBuffer fontBuffer(font.getGlyphData(fontSize), font.getGlyphDataSize(fontSize));
+	TextBuffer previewText(PreviewLines * PreviewLineLength);
+	uint32_t previewBlocks[ PreviewLines ];
+	for(uint32_t i = 0; i < PreviewLines; ++i)
+	{
+		char line[ PreviewLineLength ];
+		for(uint32_t j = 0; j < PreviewLineLength; ++j)
+			line[ j ] = char(32u + i * PreviewLineLength + j);
+		previewBlocks[ i ] = previewText.addBlock(PreviewLineLength, 0.0f, 0.0f, core::getColor(1.0f, 1.0f, 1.0f, 1.0f));
+		previewText.setText(previewBlocks[ i ], line, PreviewLineLength);
+	}
+	int previewWindowHeight = 0;
 
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
+	// Glyph bytes the font buffer has, main thread compares the font against these every frame.
+	uint32_t fontGlyphCount = font.getGlyphDataSize(fontSize) / FontBuffer::GlyphBytes;
+	if(fontGlyphCount > FontBuffer::GlyphCount)
+		fontGlyphCount = FontBuffer::GlyphCount;
+	std::vector<uint8_t> uploadedGlyphs(data, data + fontGlyphCount * FontBuffer::GlyphBytes);
 
-	glBindVertexArray(VAO);
+	RenderCommandBuffer frameCommands;
+	GlStateCache glState;
+	QuadBatcher batcher;
+	uint64_t quadKey = QuadBatcher::getSortKey(0u, batcher.addShader(shader), 0u, QuadBatcher::BlendOpaque);
+	uint64_t textKey = QuadBatcher::getSortKey(1u, batcher.addShader(textShader), 0u, QuadBatcher::BlendAlpha);
 
-	ShaderBuffer indexBuffer(
-		GL_ELEMENT_ARRAY_BUFFER, 
-		uint32_t(indices.size() * sizeof(uint32_t)),
-		GL_STATIC_DRAW,
-		indices.data()
-		);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.handle)
-;	//glEnableVertexAttribArray(0);  
+	uint32_t chosenLetter = 'a';
+	//uint32_t lastTicks = SDL_GetTicks();
 
-	std::vector<GPUVertexData> vertData;
+	std::vector<GPUQuad> vertData;
 	vertData.resize(12*8* (128-32 + 1) + 1);
 
 
@@ -102,10 +105,10 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 		float offX = (borderSizes + buttonSize) + app.windowWidth * 0.5f;
 		float offY = (borderSizes + buttonSize) + app.windowHeight * 0.5f;
 
-		GPUVertexData &vdata = vertData[0];
+		GPUQuad &vdata = vertData[0];
 		vdata.color = core::getColor(1.0f, 0.0f, 0.0f, 1.0f);
-		vdata.pixelSizeX = uint16_t(smallButtonSize) * 8 + 4;
-		vdata.pixelSizeY = uint16_t(smallButtonSize) * 12 + 4;
+		vdata.sizeX = uint16_t(smallButtonSize) * 8 + 4;
+		vdata.sizeY = uint16_t(smallButtonSize) * 12 + 4;
 		vdata.posX = offX;
 		vdata.posY = offY;
 	}
@@ -117,9 +120,9 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 			float offX = float((i - 4) * (borderSizes + buttonSize)) + app.windowWidth * 0.5f;
 			float offY = float((j - 6) * (borderSizes + buttonSize)) + app.windowHeight * 0.5f;
 
-			GPUVertexData &vdata = vertData[i + size_t(j) * 8 + 1];
+			GPUQuad &vdata = vertData[i + size_t(j) * 8 + 1];
 			vdata.color = 0;
-			vdata.pixelSizeX = vdata.pixelSizeY = buttonSize;
+			vdata.sizeX = vdata.sizeY = buttonSize;
 			vdata.posX = offX;
 			vdata.posY = offY;
 		}
@@ -133,7 +136,7 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 		{
 			for(int i = 0; i < 8; ++i)
 			{
-				GPUVertexData &vdata = vertData[i + size_t(j) * 8 + (size_t(k) + 1) * 8 * 12 + 1];
+				GPUQuad &vdata = vertData[i + size_t(j) * 8 + (size_t(k) + 1) * 8 * 12 + 1];
 
 				float smallOffX = float(i * (smallButtonSize)) + 10.0f + float(x * 8) * smallButtonSize + x * 2;
 				float smallOffY = float(j * (smallButtonSize)) + 10.0f + float(y * 12) * smallButtonSize + y * 2;
@@ -142,7 +145,7 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 				bool isVisible = ((data[indx] >> i) & 1) == 1;
 
 				vdata.color = isVisible ? ~0u : 0u;
-				vdata.pixelSizeX = vdata.pixelSizeY = smallButtonSize;
+				vdata.sizeX = vdata.sizeY = smallButtonSize;
 				vdata.posX = smallOffX;
 				vdata.posY = smallOffY;
 
@@ -150,7 +153,36 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 		}
 	}
 
-	char buffData[12] = {};
+	// Render thread draws the last frame while the next one gets edited, the quads go over in frame packets.
+	FramePacket packets[ 2 ];
+	for(FramePacket &packet : packets)
+		packet.glyphEdits.reserve(FontBuffer::GlyphCount);
+	auto renderPacket = [&](uint32_t packetIndex)
+	{
+		const FramePacket &packet = packets[ packetIndex ];
+		for(const GlyphEdit &edit : packet.glyphEdits)
+			fontBuffer.updateGlyph(edit.letter, edit.bytes);
+		if(packet.windowHeight != previewWindowHeight)
+		{
+			previewWindowHeight = packet.windowHeight;
+			for(uint32_t i = 0; i < PreviewLines; ++i)
+				previewText.setMetrics(previewBlocks[ i ], 18.0f, float(previewWindowHeight) - 20.0f - float(i) * 26.0f, 16, 24);
+		}
+
+		glClear(GL_COLOR_BUFFER_BIT);
+		frameCommands.setViewport(uint32_t(packet.windowWidth), uint32_t(packet.windowHeight));
+		frameCommands.bindStorage(1, fontBuffer.buffer);
+		batcher.addQuads(quadKey, packet.quads.data(), uint32_t(packet.quads.size()));
+		batcher.addText(textKey, previewText);
+		batcher.flush(frameCommands, GLfloat(packet.windowWidth), GLfloat(packet.windowHeight));
+		frameCommands.submit(glState);
+		batcher.endFrame();
+	};
+	core::RenderThread renderThread;
+	if(!renderThread.start(app, 2u, renderPacket))
+		return;
+
+	uint8_t buffData[12] = {};
 	SDL_Event event;
 	bool quit = false;
 	float dt = 0.0f;
@@ -159,12 +191,19 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 	Uint64 lastStamp = 0;
 	double freq = (double)SDL_GetPerformanceFrequency();
 
+	core::FrameArena frameArena;
+	core::FrameAllocationCheck allocationCheck(app.benchmarkFrames > 0u);
 
-	while (!quit)
+	while (!quit && !app.isBenchmarkDone())
 	{
+		// Packet is taken first, so the edits of the frame count into its main thread time.
+		FramePacket &packet = packets[ renderThread.beginPacket() ];
+
 		lastStamp = nowStamp;
 		nowStamp = SDL_GetPerformanceCounter();
 		dt = float((nowStamp - lastStamp)*1000 / freq );
+		if(app.benchmarkFrames > 0u)
+			dt = app.fixedDt * 1000.0f;
 
 
 		int mouseX, mouseY;
@@ -189,14 +228,21 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 					if(((event.key.keysym.mod) & (KMOD_CTRL | KMOD_LCTRL | KMOD_RCTRL)) != 0 &&
 						event.key.keysym.sym == SDLK_s)
 					{
-						// save;
-						saveFontData(filename, data);
+						// save, on windows this moves the font off the mapping, so glyph pointer has to be fetched again.
+						font.save(filename);
+						data = font.getGlyph(fontSize, 32u);
 					}
 					else if((event.key.keysym.mod & (KMOD_CTRL | KMOD_LCTRL | KMOD_RCTRL)) != 0 &&
 						event.key.keysym.sym == SDLK_l)
 					{
-						// load;
-						core::loadFontData(filename, data);
+						// load, drops the unsaved edits with the old mapping.
+						fontSize = font.open(filename, true) ? font.findSize(8u, 12u) : ~0u;
+						if(fontSize == ~0u || font.getSize(fontSize).firstChar != 32u)
+						{
+							printf("Failed to reload 8x12 font from file: %s\n", filename.c_str());
+							return;
+						}
+						data = font.getGlyph(fontSize, 32u);
 					}
 
 					else if(((event.key.keysym.mod) & (KMOD_CTRL | KMOD_LCTRL | KMOD_RCTRL)) != 0 &&
@@ -216,7 +262,7 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 						for(int i = 0; i < 12; ++i)
 						{
 							uint32_t ind = (chosenLetter - 32) * 12 + i;
-							data[ind] = char(buffData[i]); 
+							data[ind] = buffData[i]; 
 						}
 					}
 
@@ -265,21 +311,12 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 					if (event.window.event == SDL_WINDOWEVENT_RESIZED)
 					{
 						app.resizeWindow(event.window.data1, event.window.data2);
-						glUniform2f(0, GLfloat(app.windowWidth), GLfloat(app.windowHeight));
 					}
 				}
 				break;
 			}
 		}
 
-		 //Clear color buffer
-		glClear( GL_COLOR_BUFFER_BIT );
-		
-		shader.useProgram();
-		glUniform2f(0, GLfloat(app.windowWidth), GLfloat(app.windowHeight));
-
-
-		
 		for(int j = 0; j < 12; ++j)
 		{
 			
@@ -298,7 +335,7 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 				if(mouseLeftDown && insideRect)
 					data[indx] |= (1 << i);
 				else if(mouseRightDown && insideRect)
-					data[indx] &= ~(char(1 << i));
+					data[indx] &= uint8_t(~(1 << i));
 				
 				bool isVisible = ((data[indx] >> i) & 1) == 1;
 
@@ -317,21 +354,31 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 		vertData[0].posY = 10.0f + (6 + yOff * 12) * smallButtonSize + yOff * 2 - 1;
 
 
-		ssbo.updateBuffer(0, uint32_t(vertData.size() * sizeof(GPUVertexData)), vertData.data());
-		ssbo.bind(0);
-//		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindVertexArray(VAO);
-		
-		glDrawElements(GL_TRIANGLES, GLsizei(vertData.size() * 6), GL_UNSIGNED_INT, 0);
-
-		SDL_GL_SwapWindow(app.window);
-		SDL_Delay(1);
+		// Mouse edits and paste change one glyph, reload can change all of them.
+		packet.glyphEdits.clear();
+		for(uint32_t i = 0; i < fontGlyphCount; ++i)
+		{
+			uint8_t *uploaded = uploadedGlyphs.data() + i * FontBuffer::GlyphBytes;
+			const uint8_t *glyph = data + i * FontBuffer::GlyphBytes;
+			if(memcmp(uploaded, glyph, FontBuffer::GlyphBytes) == 0)
+				continue;
+
+			GlyphEdit &edit = packet.glyphEdits.emplace_back();
+			edit.letter = 32u + i;
+			memcpy(edit.bytes, glyph, FontBuffer::GlyphBytes);
+			memcpy(uploaded, glyph, FontBuffer::GlyphBytes);
+		}
+		packet.quads.assign(vertData.begin(), vertData.end());
+		packet.windowWidth = app.windowWidth;
+		packet.windowHeight = app.windowHeight;
+		renderThread.submitPacket();
 
-		char str[100];
 		char renderLetter = chosenLetter != 127 ? char(chosenLetter) : ' ';
-		sprintf(str, "%2.2fms, fps: %4.2f, mx: %i, my: %i, mbs: %i ml: %i, mr: %i, Letter: %c", 
+		const char *title = frameArena.format("%2.2fms, fps: %4.2f, mx: %i, my: %i, mbs: %i ml: %i, mr: %i, Letter: %c", 
 			dt, 1000.0f / dt, mouseX, mouseY, mousePress, mouseLeftDown, mouseRightDown, renderLetter);
-		SDL_SetWindowTitle(app.window, str);
+		SDL_SetWindowTitle(app.window, title);
+		frameArena.reset();
+		allocationCheck.endFrame();
 
 		//printf("Frame duration: %f fps: %f\n", dt, 1000.0f / dt);
 	}
@@ -339,7 +386,10 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 
 int main(int argCount, char **argv) 
 {
-	std::vector<char> data;
+	core::App app;
+	argCount = app.parseArguments(argCount, argv);
+
+	core::FontFile font;
 	std::string filename;
 	if(argCount < 2)
 	{
@@ -350,16 +400,19 @@ int main(int argCount, char **argv)
 		filename = argv[1];
 	}
 	
-	if (!core::loadFontData(filename, data))
-	{
+	uint32_t fontSize = font.open(filename, true) ? font.findSize(8u, 12u) : ~0u;
+	if(fontSize != ~0u && font.getSize(fontSize).firstChar != 32u)
+		fontSize = ~0u;
 
+	if (fontSize == ~0u)
+	{
+		printf("Failed to load 8x12 font from file: %s\n", filename.c_str());
 	}
 	else
 	{
-		core::App app;
 		if (app.init("OpenGL 4.5", SCREEN_WIDTH, SCREEN_HEIGHT))
 		{
-			mainProgramLoop(app, data, filename);
+			mainProgramLoop(app, font, fontSize, filename);
 		}
 	}
 	return 0;
@@ -6,10 +6,21 @@
 #include "glad/glad.h"
 #include <SDL2/SDL.h>
 
+#include "core/allocationcounter.h"
 #include "core/app.h"
-
+#include "core/fontfile.h"
+#include "core/framearena.h"
+#include "core/jobsystem.h"
+#include "core/renderthread.h"
+#include "core/sdfbaker.h"
+#include "core/vfs.h"
+
+#include "ogl/glyphatlas.h"
+#include "ogl/glstatecache.h"
+#include "ogl/quadbatcher.h"
+#include "ogl/rendercommandbuffer.h"
 #include "ogl/shader.h"
-#include "ogl/shaderbuffer.h"
+#include "ogl/textbuffer.h"
 
 #include <string>
 #include <vector>
@@ -19,93 +30,6 @@
 static constexpr int SCREEN_WIDTH  = 640;
 static constexpr int SCREEN_HEIGHT = 540;
 
-struct GPUVertexData
-{
-	float posX;
-	float posY;
-	uint16_t pixelSizeX;
-	uint16_t pixelSizeY;
-	uint32_t color;
-
-	float uvX;
-	float uvY;
-
-	float padding[2];
-};
-
-static const char *vertSrc = R"(
-	#version 450 core
-
-	layout (location = 0) uniform vec2 windowSize;
-
-	struct VData
-	{
-		vec2 vpos;
-		uint vSizes;
-		uint vColor;
-
-		vec2 vUv;
-		vec2 tmp;
-	};
-
-	layout (std430, binding=0) buffer shader_data
-	{
-		VData values[];
-	};
-
-
-	layout (location = 0) out vec4 colOut;
-	layout (location = 1) out vec2 uvOut;
-	void main()
-	{
-		int quadId = gl_VertexID / 4;
-		int vertId = gl_VertexID % 4;
-
-		vec2 p = vec2(-0.5f, -0.5f);
-		p.x = (vertId + 1) % 4 < 2 ? -0.5f : 0.5f;
-		p.y = vertId < 2 ? -0.5f : 0.5f;
-
-		uvOut = p + 0.5f;
-		
-		uvOut.x = (uvOut.x) / (128.0f - 32.0f) + values[quadId].vUv.x;
-
-		vec2 vSize = vec2(float(values[quadId].vSizes & 0xffffu),
-			float((values[quadId].vSizes >> 16) & 0xffffu)); 
-		p *= vSize;
-		p += values[quadId].vpos;
-		p /= windowSize * 0.5f;
-		p -= 1.0f;
-		
-		gl_Position = vec4(p.xy, 0.5, 1.0);
-		vec4 c = vec4(0, 0, 0, 0);
-		c.r = float((values[quadId].vColor >> 0u) & 255u) / 255.0f;
-		c.g = float((values[quadId].vColor >> 8u) & 255u) / 255.0f;
-		c.b = float((values[quadId].vColor >> 16u) & 255u) / 255.0f;
-		c.a = float((values[quadId].vColor >> 24u) & 255u) / 255.0f;
-		colOut = c;
-	})";
-
-static const char *fragSrc = R"(
-	#version 450 core
-	layout(origin_upper_left) in vec4 gl_FragCoord;
-	layout (location = 0) out vec4 outColor;
-
-	layout (location = 0) in vec4 colIn;
-	layout (location = 1) in vec2 uvIn;
-	layout(depth_unchanged) out float gl_FragDepth;
-	
-	layout (binding = 0) uniform sampler2D ourTexture;
-
-	void main()
-	{
-		outColor = texture(ourTexture, uvIn);
-		outColor.a = clamp(outColor.a / 0.5f, 0.0f, 1.0f);
-		outColor.rgb = colIn.rgb;
-
-	}
-	)";
-
-
 
 struct Cursor
 {
@@ -116,139 +40,83 @@ struct Cursor
 	int charHeight = 12;
 };
 
-static void addText(std::string &str, std::vector<GPUVertexData> &vertData, Cursor &cursor)
+struct TextBlocks
 {
-	for(int i = 0; i < int(str.length()); ++i)
-	{
-		GPUVertexData vdata;
-		vdata.color = core::getColor(0.0f, 1.0f, 0.0f, 1.0f);
-		vdata.pixelSizeX = cursor.charWidth;
-		vdata.pixelSizeY = cursor.charHeight;
-		vdata.posX = cursor.xPos;
-		vdata.posY = cursor.yPos;
-
-		uint32_t letter = str[i] - 32;
-
-		vdata.uvX = float(letter) / float(128-32);
-		vdata.uvY = 0.0f;
-
-		vertData.emplace_back(vdata);
+	uint32_t metrics = 0u;
+	uint32_t text = 0u;
+};
 
-		cursor.xPos += cursor.charWidth;
-	}
+// Everything the render thread needs for a frame. Text and cursor only come when they changed, the text
+// buffer on the render thread keeps the last ones.
+struct FramePacket
+{
+	std::string text;
+	Cursor cursor;
+	bool textChanged = false;
+	bool cursorChanged = false;
+	int windowWidth = 0;
+	int windowHeight = 0;
+};
 
-}
-static void updateText(std::string &str, std::vector<GPUVertexData> &vertData, Cursor &cursor)
+static void updateText(TextBuffer &textBuffer, const TextBlocks &blocks, const Cursor &cursor)
 {
-	cursor.xPos = 100.0f;
-	cursor.yPos = 400.0f;
-	std::string tmpStr = "w";
-	tmpStr += std::to_string(cursor.charWidth);
-	tmpStr += ",h";
-	tmpStr += std::to_string(cursor.charHeight);
-	vertData.clear();
-	addText(tmpStr, vertData, cursor);
-
-	cursor.xPos = 100.0f;
-	cursor.yPos = 100.0f;
-	addText(str, vertData, cursor);
+	char tmpStr[32];
+	int tmpLen = snprintf(tmpStr, sizeof(tmpStr), "w%i,h%i", cursor.charWidth, cursor.charHeight);
+	textBuffer.setMetrics(blocks.metrics, 100.0f, 400.0f, cursor.charWidth, cursor.charHeight);
+	textBuffer.setText(blocks.metrics, tmpStr, uint32_t(tmpLen));
+
+	textBuffer.setMetrics(blocks.text, 100.0f, 100.0f, cursor.charWidth, cursor.charHeight);
 }
 
 
 
 
-static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string &filename)
+static void mainProgramLoop(core::App &app, core::FontFile &font, uint32_t fontSize, std::string &filename)
 {
 	Shader shader;
-	if(!shader.initShader("assets/shaders/texturedquad.vert", "assets/shaders/texturedquad.frag"))
+	if(!shader.initShader("assets/shaders/texturedquad.vert", "assets/shaders/sdftext.frag"))
 	{
 		printf("Failed to init shader\n");
 		return;
 	}
 
 
-	ShaderBuffer ssbo(GL_SHADER_STORAGE_BUFFER, 10240u * 16u, GL_DYNAMIC_COPY, nullptr);
-	
-
-	std::vector<uint32_t> indices;
-	indices.resize(6 * 10240);
-	for(int i = 0; i < 10240; ++i)
+	// Distance field glyphs get baked when text first uses them, one atlas stays sharp at every char size.
+	GlyphAtlas glyphAtlas(font, 1024u, 1024u, 1024u);
+	// The font size starts from the disk cache, baked on the job system on the first run, so only glyphs
+	// outside it get baked on demand.
 	{
-		indices[size_t(i) * 6 + 0] = i * 4 + 0;
-		indices[size_t(i) * 6 + 1] = i * 4 + 1;
-		indices[size_t(i) * 6 + 2] = i * 4 + 2;
-
-		indices[size_t(i) * 6 + 3] = i * 4 + 0;
-		indices[size_t(i) * 6 + 4] = i * 4 + 2;
-		indices[size_t(i) * 6 + 5] = i * 4 + 3;
+		core::SdfAtlas sdfAtlas;
+		core::JobSystem jobSystem;
+		jobSystem.init();
+		if(core::loadOrBakeSdfAtlas(font, fontSize, core::SdfBakeParams{}, &jobSystem, "sdf_cache", sdfAtlas))
+			glyphAtlas.addBakedGlyphs(fontSize, sdfAtlas);
 	}
 
+	// Text stays in the buffer, only changed glyphs get uploaded.
+	TextBuffer textBuffer(10240u);
+	textBuffer.setGlyphAtlas(&glyphAtlas, fontSize);
+	TextBlocks textBlocks;
+	textBlocks.metrics = textBuffer.addBlock(32u, 100.0f, 400.0f, core::getColor(0.0f, 1.0f, 0.0f, 1.0f));
+	const uint32_t maxTextGlyphs = 10240u - 32u;
+	textBlocks.text = textBuffer.addBlock(maxTextGlyphs, 100.0f, 100.0f, core::getColor(0.0f, 1.0f, 0.0f, 1.0f));
+	
 
-	unsigned int VAO;
-	glGenVertexArrays(1, &VAO);
-
-	glBindVertexArray(VAO);
-
-	ShaderBuffer indexBuffer(
-		GL_ELEMENT_ARRAY_BUFFER, 
-		uint32_t(indices.size() * sizeof(uint32_t)),
-		GL_STATIC_DRAW,
-		indices.data()
-		);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.handle);
-	//glEnableVertexAttribArray(0);  
-
-	std::vector<GPUVertexData> vertData;
-
+	RenderCommandBuffer frameCommands;
+	GlStateCache glState;
+	QuadBatcher batcher;
+	uint64_t textKey = QuadBatcher::getSortKey(0u, batcher.addShader(shader), batcher.addTexture(glyphAtlas.texture),
+		QuadBatcher::BlendAlpha);
 
 
+	// Utf-8 is at most 4 bytes per glyph, typing up to the block size doesn't allocate.
 	std::string txt = "Hiiohoi";
-
-
-	uint32_t texHandle = 0;
-
-	{
-		std::vector<uint8_t> fontPic;
-		fontPic.resize((128-32) * 8 * 12 * 4);
-
-		// Note save order is a bit messed up!!! Since the file has one char 8x12 then next
-		uint32_t index = 0;
-		for(int y = 0; y < 12; ++y)
-		{
-			for(int charIndex = 0; charIndex < 128 - 32; ++charIndex)
-			{
-				uint8_t p = data[y + size_t(charIndex) * 12];
-				for(int x = 0; x < 8; ++x)
-				{
-					uint8_t bitColor = uint8_t((p >> x) & 1) * 255;
-					fontPic[size_t(index) * 4 + 0] = bitColor;
-					fontPic[size_t(index) * 4 + 1] = bitColor;
-					fontPic[size_t(index) * 4 + 2] = bitColor;
-					fontPic[size_t(index) * 4 + 3] = bitColor;
-
-					++index;
-				}
-			}
-		}
-		const int textureWidth = 8*(128-32);
-		const int textureHeight = 12;
-
-		glGenTextures(1, &texHandle);
-		glBindTexture(GL_TEXTURE_2D, texHandle);
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, textureWidth, textureHeight);
-		
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_BGRA, GL_UNSIGNED_BYTE, fontPic.data());
-	}
-
-
-
+	txt.reserve(maxTextGlyphs * 4u);
 
 
 	Cursor cursor;
-	updateText(txt, vertData, cursor);
+	textBuffer.setText(textBlocks.text, txt);
+	updateText(textBuffer, textBlocks, cursor);
 
 	SDL_Event event;
 	bool quit = false;
@@ -260,11 +128,46 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 
 
 	app.setClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-	while (!quit)
+
+	// Glyph atlas bakes and uploads glyphs when text uses them, so text buffer only gets touched on the
+	// render thread.
+	FramePacket packets[ 2 ];
+	for(FramePacket &packet : packets)
+		packet.text.reserve(maxTextGlyphs * 4u);
+	auto renderPacket = [&](uint32_t packetIndex)
 	{
+		const FramePacket &packet = packets[ packetIndex ];
+		if(packet.textChanged)
+			textBuffer.setText(textBlocks.text, packet.text);
+		if(packet.cursorChanged)
+			updateText(textBuffer, textBlocks, packet.cursor);
+
+		glClear(GL_COLOR_BUFFER_BIT);
+		frameCommands.setViewport(uint32_t(packet.windowWidth), uint32_t(packet.windowHeight));
+		frameCommands.bindStorage(3, glyphAtlas.rectBuffer);
+		batcher.addText(textKey, textBuffer);
+		batcher.flush(frameCommands, GLfloat(packet.windowWidth), GLfloat(packet.windowHeight));
+		frameCommands.submit(glState);
+		batcher.endFrame();
+	};
+	core::RenderThread renderThread;
+	if(!renderThread.start(app, 2u, renderPacket))
+		return;
+
+	core::FrameArena frameArena;
+	core::FrameAllocationCheck allocationCheck(app.benchmarkFrames > 0u);
+
+	while (!quit && !app.isBenchmarkDone())
+	{
+		FramePacket &packet = packets[ renderThread.beginPacket() ];
+		packet.textChanged = false;
+		packet.cursorChanged = false;
+
 		lastStamp = nowStamp;
 		nowStamp = SDL_GetPerformanceCounter();
 		dt = float((nowStamp - lastStamp)*1000 / freq );
+		if(app.benchmarkFrames > 0u)
+			dt = app.fixedDt * 1000.0f;
 
 
 		while (SDL_PollEvent(&event))
@@ -275,52 +178,52 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 					quit = true;
 					break;
 				
-				case SDL_KEYDOWN:
+				// Utf-8 from the keyboard layout.
+				case SDL_TEXTINPUT:
 				{
-					if(event.key.keysym.sym >= 32 && event.key.keysym.sym < 128)
-					{
-						if(((event.key.keysym.mod) & (KMOD_SHIFT | KMOD_LSHIFT | KMOD_RSHIFT | KMOD_CAPS)) != 0 &&
-							event.key.keysym.sym >= 96 && event.key.keysym.sym <= 122)
-						{
-							txt += char(event.key.keysym.sym - 32);
-						
-						} 
-						else
-						{
-							txt += char(event.key.keysym.sym);
-						}
-						updateText(txt, vertData, cursor);
-
-					}
+					txt += event.text.text;
+					packet.textChanged = true;
+					break;
+				}
 
+				case SDL_KEYDOWN:
+				{
 					switch(event.key.keysym.sym)
 					{
 						case SDLK_ESCAPE:
 							quit = true;
 							break;
+						case SDLK_BACKSPACE:
+							// Remove the whole last code point.
+							while(!txt.empty() && (uint8_t(txt.back()) & 0xC0u) == 0x80u)
+								txt.pop_back();
+							if(!txt.empty())
+								txt.pop_back();
+							packet.textChanged = true;
+							break;
 						case SDLK_UP:
 							cursor.charHeight++;
-							updateText(txt, vertData, cursor);
+							packet.cursorChanged = true;
 							break;
 
 						case SDLK_DOWN:
 							cursor.charHeight--;
 							if(cursor.charHeight < 2)
 								++cursor.charHeight;
-							updateText(txt, vertData, cursor);
+							packet.cursorChanged = true;
 							break;
 
 						case SDLK_LEFT:
 							cursor.charWidth--;
 							if(cursor.charWidth < 2)
 								++cursor.charWidth;
-							updateText(txt, vertData, cursor);
+							packet.cursorChanged = true;
 							break;
 
 
 						case SDLK_RIGHT:
 							cursor.charWidth++;
-							updateText(txt, vertData, cursor);
+							packet.cursorChanged = true;
 							break;
 
 						default:
@@ -334,41 +237,22 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 					if (event.window.event == SDL_WINDOWEVENT_RESIZED)
 					{
 						app.resizeWindow(event.window.data1, event.window.data2);
-						glUniform2f(0, GLfloat(app.windowWidth), GLfloat(app.windowHeight));
 					}
 					break;
 				}
 			}
 		}
 
-		 //Clear color buffer
-		glClear( GL_COLOR_BUFFER_BIT );
-		
-		shader.useProgram();
-		glUniform2f(0, GLfloat(app.windowWidth), GLfloat(app.windowHeight));
-
-
-		
-
-		ssbo.updateBuffer(0, uint32_t(vertData.size() * sizeof(GPUVertexData)), vertData.data());
-		ssbo.bind(0);
-//		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindVertexArray(VAO);
-
-		glBindTexture(GL_TEXTURE_2D, texHandle);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		if(packet.textChanged)
+			packet.text = txt;
+		packet.cursor = cursor;
+		packet.windowWidth = app.windowWidth;
+		packet.windowHeight = app.windowHeight;
+		renderThread.submitPacket();
 
-
-		glDrawElements(GL_TRIANGLES, GLsizei(vertData.size() * 6), GL_UNSIGNED_INT, 0);
-
-		SDL_GL_SwapWindow(app.window);
-		SDL_Delay(1);
-
-		char str[100];
-		sprintf(str, "%2.2fms, fps: %4.2f", 
-			dt, 1000.0f / dt);
-		SDL_SetWindowTitle(app.window, str);
+		SDL_SetWindowTitle(app.window, frameArena.format("%2.2fms, fps: %4.2f", dt, 1000.0f / dt));
+		frameArena.reset();
+		allocationCheck.endFrame();
 
 		//printf("Frame duration: %f fps: %f\n", dt, 1000.0f / dt);
 	}
@@ -376,7 +260,10 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 
 int main(int argCount, char **argv) 
 {
-	std::vector<char> data;
+	core::App app;
+	argCount = app.parseArguments(argCount, argv);
+
+	core::FontFile font;
 	std::string filename;
 	if(argCount < 2)
 	{
@@ -387,17 +274,20 @@ int main(int argCount, char **argv)
 		filename = argv[1];
 	}
 	
-	if(core::loadFontData(filename, data))
+	uint32_t fontSize = font.open(core::getVfs().getFile(filename)) ? font.findSize(8u, 12u) : ~0u;
+	if(fontSize != ~0u && font.getSize(fontSize).firstChar != 32u)
+		fontSize = ~0u;
+
+	if(fontSize != ~0u)
 	{
-		core::App app;
 		if(app.init("OpenGL 4.5, render font", SCREEN_WIDTH, SCREEN_HEIGHT))
 		{
-			mainProgramLoop(app, data, filename);
+			mainProgramLoop(app, font, fontSize, filename);
 		}
 	}
 	else
 	{
-		printf("Failed to load file: %s\n", filename.c_str());
+		printf("Failed to load 8x12 font from file: %s\n", filename.c_str());
 	}
 	
 	return 0;
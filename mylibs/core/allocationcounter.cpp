@@ -0,0 +1,102 @@
+#include "allocationcounter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <cassert>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifndef NDEBUG
+
+static std::atomic<uint64_t> allocationCount{ 0u };
+
+// Array and nothrow forms go through these in the standard library. Aligned forms don't, libstdc++ and
+// msvc allocate them straight with aligned_alloc / _aligned_malloc, so they are replaced too.
+void *operator new(size_t size)
+{
+	allocationCount.fetch_add(1u, std::memory_order_relaxed);
+	void *ptr = malloc(size > 0u ? size : 1u);
+	if(!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+	allocationCount.fetch_add(1u, std::memory_order_relaxed);
+	size_t align = size_t(alignment);
+	size = size > 0u ? size : 1u;
+#ifdef _WIN32
+	void *ptr = _aligned_malloc(size, align);
+#else
+	// aligned_alloc wants size to be multiple of the alignment.
+	void *ptr = aligned_alloc(align, (size + align - 1u) / align * align);
+#endif
+	if(!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(ptr, alignment);
+}
+
+#endif
+
+namespace core {
+
+uint64_t getAllocationCount()
+{
+#ifndef NDEBUG
+	return allocationCount.load(std::memory_order_relaxed);
+#else
+	return 0u;
+#endif
+}
+
+FrameAllocationCheck::FrameAllocationCheck(bool enabled, uint32_t warmupFrames)
+{
+	this->enabled = enabled;
+	this->warmupFrames = warmupFrames;
+	lastCount = getAllocationCount();
+}
+
+void FrameAllocationCheck::endFrame()
+{
+	uint64_t count = getAllocationCount();
+	lastFrameAllocations = count - lastCount;
+	lastCount = count;
+	++frame;
+
+	if(!enabled || frame <= warmupFrames || lastFrameAllocations == 0u)
+		return;
+
+	printf("Frame %u made %u heap allocations in steady state\n", frame, uint32_t(lastFrameAllocations));
+	assert(false && "Steady state frame allocated from heap");
+}
+
+}; // end of core namespace.
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace core
+{
+
+// Global operator new calls since start, from every thread, aligned forms included. Only debug builds
+// count, release builds always return 0. Plain malloc, like SDL and the gl driver use, is not counted.
+uint64_t getAllocationCount();
+
+// Checks that frames after warmup don't allocate. Meant for benchmark runs, they have no input so every
+// frame after warmup is steady state and any allocation is a regression. Counter is global, so allocations
+// from the render thread and job threads count for the frame they happen in.
+class FrameAllocationCheck
+{
+public:
+	FrameAllocationCheck(bool enabled, uint32_t warmupFrames = 60u);
+
+	// Call once per main loop iteration, asserts if the frame allocated.
+	void endFrame();
+
+	uint64_t lastFrameAllocations = 0u;
+
+private:
+	bool enabled = false;
+	uint32_t warmupFrames = 0u;
+	uint32_t frame = 0u;
+	uint64_t lastCount = 0u;
+};
+
+}; // end of core namespace.
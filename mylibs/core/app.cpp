@@ -1,12 +1,13 @@
 #include "app.h"
+#include "vfs.h"
 #include <SDL2/SDL.h>
 
 #include "glad/glad.h"
 
 #include <stdio.h>
-#include <filesystem>
-#include <fstream>
 #include <cmath>
+#include <cstring>
+#include <cstdlib>
 
 static void APIENTRY openglCallbackFunction(
 	GLenum source,
@@ -35,8 +36,48 @@ static void APIENTRY openglCallbackFunction(
 
 namespace core {
 
+int App::parseArguments(int argCount, char **argv)
+{
+	int outCount = argCount > 0 ? 1 : 0;
+	for(int i = 1; i < argCount; ++i)
+	{
+		if(strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+			if(benchmarkFrames == 0u)
+				benchmarkFrames = 1000u;
+		}
+		else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argCount)
+		{
+			benchmarkFrames = uint32_t(atoi(argv[++i]));
+		}
+		else if(strcmp(argv[i], "--dt") == 0 && i + 1 < argCount)
+		{
+			fixedDt = float(atof(argv[++i])) / 1000.0f;
+		}
+		else if(strcmp(argv[i], "--archive") == 0 && i + 1 < argCount)
+		{
+			archiveFileName = argv[++i];
+		}
+		else
+		{
+			argv[outCount++] = argv[i];
+		}
+	}
+
+	// Mounted here and not in init, so apps can load assets before creating the window.
+	if(!getVfs().mountArchive(archiveFileName))
+		printf("No asset archive %s, using loose files\n", archiveFileName.c_str());
+	return outCount;
+}
+
 bool App::init(const char *windowStr, int screenWidth, int screenHeight)
 {
+	// Headless runs go through SDL offscreen driver, which creates EGL pbuffer without
+	// needing display server, on Mesa this ends up using llvmpipe when there is no gpu.
+	if(headless)
+		SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+
 	// Initialize SDL 
 	if (SDL_Init(SDL_INIT_VIDEO) < 0)
 	{
@@ -58,12 +99,16 @@ bool App::init(const char *windowStr, int screenWidth, int screenHeight)
 	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
 	SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
 
-	// Debug!
-	SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+	// Debug! Not for benchmarks, debug contexts can be a lot slower.
+	if(benchmarkFrames == 0u)
+		SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
 
+	uint32_t windowFlags = SDL_WINDOW_OPENGL;
+	if(headless)
+		windowFlags |= SDL_WINDOW_HIDDEN;
 
 	window = SDL_CreateWindow(windowStr, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-		screenWidth, screenHeight, SDL_WINDOW_OPENGL);
+		screenWidth, screenHeight, windowFlags);
 
 
 	if (window == NULL)
@@ -112,12 +157,28 @@ bool App::init(const char *windowStr, int screenWidth, int screenHeight)
 	glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
 	//glClipControl(GL_UPPER_LEFT, GL_ZERO_TO_ONE);
 
+	if(benchmarkFrames > 0u)
+	{
+		printf("Benchmark: %u frames, fixed dt: %2.3fms, headless: %i\n", 
+			benchmarkFrames, fixedDt * 1000.0f, headless);
+		setVsyncEnabled(false);
+		frameCpuTimes.resize(benchmarkFrames);
+		frameMainTimes.resize(benchmarkFrames);
+		frameMainWaitTimes.resize(benchmarkFrames);
+		frameQueries.resize(size_t(benchmarkFrames) * 2u);
+		glGenQueries(GLsizei(frameQueries.size()), frameQueries.data());
+	}
+
 	return true;
 
 }
 
 App::~App()
 {
+	if(!frameQueries.empty() && mainContext)
+		glDeleteQueries(GLsizei(frameQueries.size()), frameQueries.data());
+	frameQueries.clear();
+
 	if(mainContext)
 		SDL_GL_DeleteContext(mainContext);
 	mainContext = nullptr;
@@ -130,43 +191,116 @@ void App::resizeWindow(int w, int h)
 	windowWidth = w;
 	windowHeight = h;
 	printf("Window size: %i: %i\n", w, h);
-	glViewport(0, 0, w, h);
 }
 
 void App::setVsyncEnabled(bool enable)
 {
-	vSync = enable;
+	// Benchmark runs never wait for vsync.
+	vSync = enable && benchmarkFrames == 0u;
 	// Use v-sync
 	SDL_GL_SetSwapInterval(vSync);
 }
 
 
 
+bool App::setContextCurrent(bool current)
+{
+	if(SDL_GL_MakeCurrent(window, current ? mainContext : nullptr) != 0)
+	{
+		printf("Failed to %s GL context: %s\n", current ? "make current" : "release", SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
 void App::setClearColor(float r, float g, float b, float a)
 {
 	glClearColor(r, g, b, a);
 }
 
+void App::beginFrame()
+{
+	frameStartStamp = SDL_GetPerformanceCounter();
+	if(frameIndex < benchmarkFrames)
+		glQueryCounter(frameQueries[size_t(frameIndex) * 2u + 0u], GL_TIMESTAMP);
+}
 
-bool loadFontData(const std::string &fileName, std::vector<char> &dataOut)
+void App::endFrame()
 {
-	//
-	if (std::filesystem::exists(fileName))
-	{
-		std::filesystem::path p(fileName);
-		uint32_t s = uint32_t(std::filesystem::file_size(p));
+	if(frameIndex < benchmarkFrames)
+		glQueryCounter(frameQueries[size_t(frameIndex) * 2u + 1u], GL_TIMESTAMP);
 
-		dataOut.resize(s);
+	SDL_GL_SwapWindow(window);
 
-		std::ifstream f(p, std::ios::in | std::ios::binary);
+	if(frameIndex < benchmarkFrames)
+	{
+		uint64_t endStamp = SDL_GetPerformanceCounter();
+		frameCpuTimes[frameIndex] = float(double(endStamp - frameStartStamp) * 1000.0 / 
+			double(SDL_GetPerformanceFrequency()));
+	}
+	else if(benchmarkFrames == 0u)
+	{
+		SDL_Delay(1);
+	}
 
+	++frameIndex;
+	if(frameIndex == benchmarkFrames)
+		printFrameTimings();
+}
 
-		f.read(dataOut.data(), s);
+void App::setMainFrameTime(uint32_t frame, float mainMs, float waitMs)
+{
+	if(frame < frameMainTimes.size())
+	{
+		frameMainTimes[frame] = mainMs;
+		frameMainWaitTimes[frame] = waitMs;
+	}
+}
 
-		printf("filesize: %u\n", s);
-		return true;
+void App::printFrameTimings()
+{
+	// Queries are only resolved after the run, so they never stall the frames being measured.
+	// Main ms is the simulation and packet build, only there when running with RenderThread. Cpu ms is the
+	// render side of the frame, submission and swap.
+	double mainTotal = 0.0;
+	double waitTotal = 0.0;
+	double cpuTotal = 0.0;
+	double gpuTotal = 0.0;
+	float mainMin = 1.0e9f, mainMax = 0.0f;
+	float cpuMin = 1.0e9f, cpuMax = 0.0f;
+	float gpuMin = 1.0e9f, gpuMax = 0.0f;
+
+	printf("frame, main ms, main wait ms, cpu ms, gpu ms\n");
+	for(uint32_t i = 0; i < benchmarkFrames; ++i)
+	{
+		GLuint64 startTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(frameQueries[size_t(i) * 2u + 0u], GL_QUERY_RESULT, &startTime);
+		glGetQueryObjectui64v(frameQueries[size_t(i) * 2u + 1u], GL_QUERY_RESULT, &endTime);
+
+		float mainTime = frameMainTimes[i];
+		float waitTime = frameMainWaitTimes[i];
+		float cpuTime = frameCpuTimes[i];
+		float gpuTime = float(double(endTime - startTime) / 1000000.0);
+		printf("%u, %2.3f, %2.3f, %2.3f, %2.3f\n", i, mainTime, waitTime, cpuTime, gpuTime);
+
+		mainTotal += mainTime;
+		waitTotal += waitTime;
+		mainMin = fminf(mainMin, mainTime);
+		mainMax = fmaxf(mainMax, mainTime);
+		cpuTotal += cpuTime;
+		gpuTotal += gpuTime;
+		cpuMin = fminf(cpuMin, cpuTime);
+		cpuMax = fmaxf(cpuMax, cpuTime);
+		gpuMin = fminf(gpuMin, gpuTime);
+		gpuMax = fmaxf(gpuMax, gpuTime);
 	}
-	return false;
+	printf("main avg: %2.3fms, min: %2.3fms, max: %2.3fms, wait avg: %2.3fms\n", 
+		mainTotal / double(benchmarkFrames), mainMin, mainMax, waitTotal / double(benchmarkFrames));
+	printf("cpu avg: %2.3fms, min: %2.3fms, max: %2.3fms\n", 
+		cpuTotal / double(benchmarkFrames), cpuMin, cpuMax);
+	printf("gpu avg: %2.3fms, min: %2.3fms, max: %2.3fms\n", 
+		gpuTotal / double(benchmarkFrames), gpuMin, gpuMax);
 }
 
 
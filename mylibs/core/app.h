@@ -1,3 +1,7 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -11,21 +15,57 @@ namespace core
 class App
 {
 public:
+	// Strips the options handled by app from argv and returns the remaining argument count.
+	// --headless          create the context without a visible window (SDL offscreen driver, EGL).
+	// --frames <count>    run given amount of frames with fixed dt and no vsync, then print timings.
+	// --dt <ms>           fixed frame time used for benchmark runs, defaults to 16.667ms.
+	// --archive <file>    asset archive to mount, defaults to assets.pak. Without it assets load as loose files.
+	int parseArguments(int argCount, char **argv);
+
 	bool init(const char *windowStr, int screenWidth, int screenHeight);
 	virtual ~App();
+	// Only stores the size, renderers set the viewport from windowWidth and windowHeight.
 	void resizeWindow(int w, int h);
 	void setVsyncEnabled(bool enable);
 	void setClearColor(float r, float g, float b, float a);
 
+	// Context can be current on one thread at a time, RenderThread moves it over with these.
+	bool setContextCurrent(bool current);
+
+	// beginFrame / endFrame wrap every frame, endFrame swaps the window. With RenderThread they run on the
+	// render thread and time its side of the frame.
+	void beginFrame();
+	void endFrame();
+	// RenderThread stores the main thread side of frame, from beginPacket to submitPacket, and how long
+	// beginPacket waited for the render thread. Has to be called before the frame's packet is submitted.
+	void setMainFrameTime(uint32_t frame, float mainMs, float waitMs);
+	bool isBenchmarkDone() const { return benchmarkFrames > 0 && frameIndex >= benchmarkFrames; }
+
 	public: 
 		SDL_Window *window = nullptr;
 		SDL_GLContext mainContext = nullptr;		
 		int windowWidth = 0;
 		int windowHeight = 0;
 		bool vSync = true;
-};
 
-bool loadFontData(const std::string &fileName, std::vector<char> &dataOut);
+		bool headless = false;
+		// 0 means run until quit.
+		uint32_t benchmarkFrames = 0u;
+		// Fixed dt in seconds for benchmark runs.
+		float fixedDt = 1.0f / 60.0f;
+		// Render thread advances it while the main thread checks isBenchmarkDone.
+		std::atomic<uint32_t> frameIndex = 0u;
+		std::string archiveFileName = "assets.pak";
+
+	private:
+		void printFrameTimings();
+
+		uint64_t frameStartStamp = 0u;
+		std::vector<float> frameCpuTimes;
+		std::vector<float> frameMainTimes;
+		std::vector<float> frameMainWaitTimes;
+		std::vector<uint32_t> frameQueries;
+};
 
 // color values r,g,h,a between [0..1]
 uint32_t getColor(float r, float g, float b, float a);
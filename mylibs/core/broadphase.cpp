@@ -0,0 +1,134 @@
+#include "broadphase.h"
+
+#include <cmath>
+
+namespace core {
+
+void UniformGrid::build(const float *posX, const float *posY, const float *radius, uint32_t count,
+	float worldWidth, float worldHeight, float cellSize)
+{
+	this->worldWidth = worldWidth;
+	this->worldHeight = worldHeight;
+
+	// Cells get stretched to divide the world evenly, so they never get smaller than cellSize.
+	gridWidth = uint32_t(worldWidth / cellSize);
+	gridHeight = uint32_t(worldHeight / cellSize);
+	gridWidth = gridWidth > 0u ? gridWidth : 1u;
+	gridHeight = gridHeight > 0u ? gridHeight : 1u;
+
+	float cellScaleX = float(gridWidth) / worldWidth;
+	float cellScaleY = float(gridHeight) / worldHeight;
+	uint32_t cellCount = gridWidth * gridHeight;
+
+	cellStarts.assign(size_t(cellCount) + 1u, 0u);
+	entityCells.resize(count);
+	sortedIndices.resize(count);
+	sortedX.resize(count);
+	sortedY.resize(count);
+	sortedRadius.resize(count);
+
+	// Counting sort: histogram, prefix sum, scatter.
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		int32_t cx = int32_t(posX[ i ] * cellScaleX);
+		int32_t cy = int32_t(posY[ i ] * cellScaleY);
+		cx = cx < 0 ? 0 : (cx >= int32_t(gridWidth) ? int32_t(gridWidth) - 1 : cx);
+		cy = cy < 0 ? 0 : (cy >= int32_t(gridHeight) ? int32_t(gridHeight) - 1 : cy);
+		uint32_t cell = uint32_t(cx) + uint32_t(cy) * gridWidth;
+		entityCells[ i ] = cell;
+		++cellStarts[ cell + 1u ];
+	}
+
+	for(uint32_t i = 0; i < cellCount; ++i)
+		cellStarts[ i + 1u ] += cellStarts[ i ];
+
+	// Use the starts as write cursors, the loop shifts them one cell forward, so fix them after.
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		uint32_t dst = cellStarts[ entityCells[ i ] ]++;
+		sortedIndices[ dst ] = i;
+		sortedX[ dst ] = posX[ i ];
+		sortedY[ dst ] = posY[ i ];
+		sortedRadius[ dst ] = radius[ i ];
+	}
+	for(uint32_t i = cellCount; i > 0u; --i)
+		cellStarts[ i ] = cellStarts[ i - 1u ];
+	cellStarts[ 0 ] = 0u;
+}
+
+void UniformGrid::addCellPairs(uint32_t cellA, uint32_t cellB, std::vector<BroadPhasePair> &outPairs) const
+{
+	float halfWidth = worldWidth * 0.5f;
+	float halfHeight = worldHeight * 0.5f;
+
+	uint32_t startA = cellStarts[ cellA ];
+	uint32_t endA = cellStarts[ cellA + 1u ];
+	uint32_t startB = cellStarts[ cellB ];
+	uint32_t endB = cellStarts[ cellB + 1u ];
+	bool sameCell = cellA == cellB;
+
+	for(uint32_t i = startA; i < endA; ++i)
+	{
+		float x = sortedX[ i ];
+		float y = sortedY[ i ];
+		float r = sortedRadius[ i ];
+		for(uint32_t j = sameCell ? i + 1u : startB; j < endB; ++j)
+		{
+			float dx = sortedX[ j ] - x;
+			float dy = sortedY[ j ] - y;
+			dx = dx > halfWidth ? dx - worldWidth : (dx < -halfWidth ? dx + worldWidth : dx);
+			dy = dy > halfHeight ? dy - worldHeight : (dy < -halfHeight ? dy + worldHeight : dy);
+			float rr = r + sortedRadius[ j ];
+			if(dx * dx + dy * dy < rr * rr)
+			{
+				uint32_t a = sortedIndices[ i ];
+				uint32_t b = sortedIndices[ j ];
+				outPairs.push_back(a < b ? BroadPhasePair{ a, b } : BroadPhasePair{ b, a });
+			}
+		}
+	}
+}
+
+void UniformGrid::findPairs(std::vector<BroadPhasePair> &outPairs) const
+{
+	for(uint32_t cy = 0; cy < gridHeight; ++cy)
+	{
+		for(uint32_t cx = 0; cx < gridWidth; ++cx)
+		{
+			uint32_t cell = cx + cy * gridWidth;
+			if(cellStarts[ cell ] == cellStarts[ cell + 1u ])
+				continue;
+
+			addCellPairs(cell, cell, outPairs);
+
+			// Every neighbour cell pair gets visited once from the smaller cell index. Neighbours wrap
+			// around the edges, on small grids several offsets can land on the same cell so skip duplicates.
+			uint32_t visited[ 8 ];
+			uint32_t visitedCount = 0u;
+			for(int32_t oy = -1; oy <= 1; ++oy)
+			{
+				for(int32_t ox = -1; ox <= 1; ++ox)
+				{
+					if(ox == 0 && oy == 0)
+						continue;
+					uint32_t nx = (cx + gridWidth + uint32_t(ox)) % gridWidth;
+					uint32_t ny = (cy + gridHeight + uint32_t(oy)) % gridHeight;
+					uint32_t neighbour = nx + ny * gridWidth;
+					if(neighbour <= cell)
+						continue;
+
+					bool alreadyVisited = false;
+					for(uint32_t i = 0; i < visitedCount; ++i)
+						alreadyVisited = alreadyVisited || visited[ i ] == neighbour;
+					if(alreadyVisited)
+						continue;
+
+					visited[ visitedCount++ ] = neighbour;
+					addCellPairs(cell, neighbour, outPairs);
+				}
+			}
+		}
+	}
+}
+
+}; // end of core namespace.
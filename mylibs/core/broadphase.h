@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace core
+{
+
+struct BroadPhasePair
+{
+	uint32_t a;
+	uint32_t b;
+};
+
+// Uniform grid over toroidal world [0, worldWidth) x [0, worldHeight), rebuilt every frame.
+// Entities are counting sorted by cell into flat arrays, so the pair search walks memory linearly.
+class UniformGrid
+{
+public:
+	// cellSize should be at least the largest diameter, so only neighbouring cells need to be checked.
+	void build(const float *posX, const float *posY, const float *radius, uint32_t count,
+		float worldWidth, float worldHeight, float cellSize);
+
+	// Appends every pair whose circles overlap, distances wrap around the world edges. a < b.
+	void findPairs(std::vector<BroadPhasePair> &outPairs) const;
+
+	uint32_t gridWidth = 0u;
+	uint32_t gridHeight = 0u;
+
+private:
+	void addCellPairs(uint32_t cellA, uint32_t cellB, std::vector<BroadPhasePair> &outPairs) const;
+
+	float worldWidth = 0.0f;
+	float worldHeight = 0.0f;
+
+	// cellStarts[cell]..cellStarts[cell + 1] is the range of entities in the sorted arrays.
+	std::vector<uint32_t> cellStarts;
+	std::vector<uint32_t> entityCells;
+	std::vector<uint32_t> sortedIndices;
+	std::vector<float> sortedX;
+	std::vector<float> sortedY;
+	std::vector<float> sortedRadius;
+};
+
+};
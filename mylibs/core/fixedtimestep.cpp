@@ -0,0 +1,37 @@
+#include "fixedtimestep.h"
+
+#include <cassert>
+
+namespace core {
+
+FixedTimestep::FixedTimestep(float stepDt, uint32_t maxStepsPerFrame)
+{
+	assert(stepDt > 0.0f && "Step dt must be greater than 0");
+	assert(maxStepsPerFrame > 0u && "Need at least one step per frame");
+	this->stepDt = stepDt;
+	this->maxStepsPerFrame = maxStepsPerFrame;
+}
+
+uint32_t FixedTimestep::advance(float frameDt)
+{
+	accumulator += frameDt > 0.0f ? double(frameDt) : 0.0;
+
+	uint32_t steps = 0u;
+	while(accumulator >= double(stepDt) && steps < maxStepsPerFrame)
+	{
+		accumulator -= double(stepDt);
+		++steps;
+	}
+
+	if(accumulator >= double(stepDt))
+	{
+		uint64_t dropped = uint64_t(accumulator / double(stepDt));
+		droppedSteps += dropped;
+		accumulator -= double(dropped) * double(stepDt);
+	}
+
+	stepIndex += steps;
+	return steps;
+}
+
+}; // end of core namespace.
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace core
+{
+
+// Turns variable frame times into fixed size simulation steps. Leftover time stays in the accumulator,
+// and rendering interpolates between the last two simulated states with getAlpha.
+class FixedTimestep
+{
+public:
+	FixedTimestep(float stepDt, uint32_t maxStepsPerFrame);
+
+	// Returns how many steps to simulate this frame. Time beyond maxStepsPerFrame steps is dropped, so
+	// after a hitch the simulation slows down instead of trying to catch up with ever longer frames.
+	uint32_t advance(float frameDt);
+
+	// Fraction of a step the render time is past the last simulated state, [0, 1).
+	float getAlpha() const { return float(accumulator / stepDt); }
+
+	float stepDt = 0.0f;
+	uint32_t maxStepsPerFrame = 0u;
+	uint64_t stepIndex = 0u;
+	// Steps that were dropped because of the clamp.
+	uint64_t droppedSteps = 0u;
+
+private:
+	// Double, so long runs don't lose the leftover time into rounding.
+	double accumulator = 0.0;
+};
+
+}; // end of core namespace.
@@ -0,0 +1,187 @@
+#include "fontfile.h"
+
+#include <stdio.h>
+#include <cstring>
+#include <filesystem>
+
+namespace core {
+
+static constexpr uint32_t LegacyGlyphWidth = 8u;
+static constexpr uint32_t LegacyGlyphHeight = 12u;
+static constexpr uint32_t LegacyFirstChar = 32u;
+static constexpr uint32_t LegacyLastChar = 127u;
+
+static uint32_t getGlyphCount(const FontSizeInfo &sizeInfo)
+{
+	return uint32_t(sizeInfo.lastChar) - uint32_t(sizeInfo.firstChar) + 1u;
+}
+
+bool convertLegacyFont(const uint8_t *legacyData, size_t legacySize, std::vector<uint8_t> &fontOut)
+{
+	uint32_t bytesPerGlyph = LegacyGlyphHeight * ((LegacyGlyphWidth + 7u) / 8u);
+	uint32_t glyphDataSize = (LegacyLastChar - LegacyFirstChar + 1u) * bytesPerGlyph;
+	if(legacySize == 0u || legacySize > glyphDataSize || (legacySize % bytesPerGlyph) != 0u)
+	{
+		printf("Legacy font data size %u is not whole 8x12 glyphs\n", uint32_t(legacySize));
+		return false;
+	}
+
+	uint32_t dataOffset = (uint32_t(sizeof(FontFileHeader) + sizeof(FontSizeInfo)) + 15u) & ~15u;
+
+	FontFileHeader header{ .magic = FontFileMagic, .version = FontFileVersion, .sizeCount = 1u,
+		.fileSize = dataOffset + glyphDataSize };
+	FontSizeInfo sizeInfo{ .glyphWidth = LegacyGlyphWidth, .glyphHeight = LegacyGlyphHeight,
+		.firstChar = LegacyFirstChar, .lastChar = LegacyLastChar, .bytesPerGlyph = bytesPerGlyph,
+		.dataOffset = dataOffset };
+
+	// Files that end early get empty glyphs for the missing letters.
+	fontOut.assign(header.fileSize, 0u);
+	memcpy(fontOut.data(), &header, sizeof(FontFileHeader));
+	memcpy(fontOut.data() + sizeof(FontFileHeader), &sizeInfo, sizeof(FontSizeInfo));
+	memcpy(fontOut.data() + dataOffset, legacyData, legacySize);
+	return true;
+}
+
+FontFile::~FontFile()
+{
+	close();
+}
+
+bool FontFile::open(const std::string &fileName, bool copyOnWrite)
+{
+	close();
+	if(!file.open(fileName, copyOnWrite))
+	{
+		printf("Failed to open font file: %s\n", fileName.c_str());
+		return false;
+	}
+	return setData(file.data, file.size, copyOnWrite, fileName.c_str());
+}
+
+bool FontFile::open(std::span<const uint8_t> fontData)
+{
+	close();
+	// Read only, data is never written through when writable is false.
+	return setData((uint8_t *)fontData.data(), fontData.size(), false, "memory");
+}
+
+bool FontFile::setData(uint8_t *fontData, size_t fontSize, bool canWrite, const char *name)
+{
+	data = fontData;
+	size = fontSize;
+	writable = canWrite;
+	if(size < sizeof(FontFileHeader) || getHeader().magic != FontFileMagic)
+	{
+		// Old headerless file, no choice but to build the header in memory.
+		if(!convertLegacyFont(data, size, convertedData))
+		{
+			close();
+			return false;
+		}
+		data = convertedData.data();
+		size = convertedData.size();
+		inMemory = true;
+	}
+
+	if(!validate())
+	{
+		printf("Invalid font file: %s\n", name);
+		close();
+		return false;
+	}
+	return true;
+}
+
+void FontFile::close()
+{
+	file.close();
+	convertedData.clear();
+	data = nullptr;
+	size = 0u;
+	writable = false;
+	inMemory = false;
+}
+
+bool FontFile::validate() const
+{
+	const FontFileHeader &header = getHeader();
+	if(header.version != FontFileVersion || header.fileSize != size || header.sizeCount == 0u ||
+		sizeof(FontFileHeader) + size_t(header.sizeCount) * sizeof(FontSizeInfo) > size)
+		return false;
+
+	for(uint32_t i = 0; i < header.sizeCount; ++i)
+	{
+		const FontSizeInfo &sizeInfo = getSize(i);
+		uint32_t rowBytes = (uint32_t(sizeInfo.glyphWidth) + 7u) / 8u;
+		if(sizeInfo.firstChar > sizeInfo.lastChar || sizeInfo.bytesPerGlyph < rowBytes * sizeInfo.glyphHeight ||
+			(sizeInfo.dataOffset & 15u) != 0u ||
+			size_t(sizeInfo.dataOffset) + size_t(getGlyphDataSize(i)) > size)
+			return false;
+	}
+	return true;
+}
+
+bool FontFile::save(const std::string &fileName)
+{
+	if(!data)
+		return false;
+
+	std::string tmpFileName = fileName + ".tmp";
+	FILE *outFile = fopen(tmpFileName.c_str(), "wb");
+	bool success = outFile && fwrite(data, 1, size, outFile) == size;
+	if(outFile)
+		fclose(outFile);
+
+#if _WIN32
+	// Windows cannot replace a file that is still mapped, so the font moves into memory first.
+	if(success && file.isOpen())
+	{
+		bool keepWritable = writable;
+		std::vector<uint8_t> fontData(data, data + size);
+		close();
+		convertedData = std::move(fontData);
+		data = convertedData.data();
+		size = convertedData.size();
+		writable = keepWritable;
+		inMemory = true;
+	}
+#endif
+
+	std::error_code error;
+	if(success)
+		std::filesystem::rename(tmpFileName, fileName, error);
+	if(!success || error)
+	{
+		printf("Failed to save font file: %s\n", fileName.c_str());
+		return false;
+	}
+	printf("filesize: %u\n", uint32_t(size));
+	return true;
+}
+
+uint32_t FontFile::findSize(uint32_t glyphWidth, uint32_t glyphHeight) const
+{
+	for(uint32_t i = 0; i < getSizeCount(); ++i)
+	{
+		if(getSize(i).glyphWidth == glyphWidth && getSize(i).glyphHeight == glyphHeight)
+			return i;
+	}
+	return ~0u;
+}
+
+uint32_t FontFile::getGlyphDataSize(uint32_t sizeIndex) const
+{
+	const FontSizeInfo &sizeInfo = getSize(sizeIndex);
+	return getGlyphCount(sizeInfo) * sizeInfo.bytesPerGlyph;
+}
+
+uint8_t *FontFile::getGlyph(uint32_t sizeIndex, uint32_t letter)
+{
+	const FontSizeInfo &sizeInfo = getSize(sizeIndex);
+	if(!writable || letter < sizeInfo.firstChar || letter > sizeInfo.lastChar)
+		return nullptr;
+
+	return data + sizeInfo.dataOffset + (letter - sizeInfo.firstChar) * sizeInfo.bytesPerGlyph;
+}
+
+}; // end of core namespace.
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+namespace core
+{
+
+// Font file v2:
+//   FontFileHeader
+//   FontSizeInfo[ sizeCount ]
+//   glyph data for every size, starting at dataOffset of the size, 16 byte aligned.
+// Glyphs are stored one after another from firstChar to lastChar, bytesPerGlyph each. Every row is
+// (glyphWidth + 7) / 8 bytes, bit x is column x, row 0 is the bottom row.
+// Old headerless .dat files are the same glyph data for one 8x12 size from ' ' to 127.
+static constexpr uint32_t FontFileMagic = 0x544E4648u; // "HFNT"
+static constexpr uint32_t FontFileVersion = 2u;
+
+struct FontFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t sizeCount;
+	uint32_t fileSize;
+};
+
+struct FontSizeInfo
+{
+	uint16_t glyphWidth;
+	uint16_t glyphHeight;
+	uint16_t firstChar;
+	uint16_t lastChar;
+	uint32_t bytesPerGlyph;
+	uint32_t dataOffset;
+};
+
+// Memory maps font file and uses it in place. Old .dat files get converted into memory on open.
+class FontFile
+{
+public:
+	FontFile() {}
+	FontFile(const FontFile &) = delete;
+	FontFile &operator=(const FontFile &) = delete;
+	~FontFile();
+
+	// copyOnWrite maps the file privately writable, so glyphs can be edited in place without touching the file.
+	bool open(const std::string &fileName, bool copyOnWrite = false);
+	// Uses fontData in place read only, for example file from Vfs. fontData has to outlive the FontFile.
+	bool open(std::span<const uint8_t> fontData);
+	void close();
+	// Writes the current font data as v2 file. Writes temporary file and renames it over the old one.
+	// On windows a mapped font gets copied into memory first, which invalidates data and every glyph pointer.
+	bool save(const std::string &fileName);
+
+	uint32_t getSizeCount() const { return getHeader().sizeCount; }
+	const FontSizeInfo &getSize(uint32_t sizeIndex) const { return getSizes()[ sizeIndex ]; }
+	// Returns size index or ~0u.
+	uint32_t findSize(uint32_t glyphWidth, uint32_t glyphHeight) const;
+
+	// Glyph data of every glyph in the size.
+	const uint8_t *getGlyphData(uint32_t sizeIndex) const { return data + getSize(sizeIndex).dataOffset; }
+	uint32_t getGlyphDataSize(uint32_t sizeIndex) const;
+	// Returns nullptr if letter is not in the size, or file is not writable.
+	uint8_t *getGlyph(uint32_t sizeIndex, uint32_t letter);
+
+	uint8_t *data = nullptr;
+	size_t size = 0u;
+	bool writable = false;
+	// Data lives in memory instead of the mapping, old .dat files get converted on open.
+	bool inMemory = false;
+
+private:
+	const FontFileHeader &getHeader() const { return *(const FontFileHeader *)data; }
+	const FontSizeInfo *getSizes() const { return (const FontSizeInfo *)(data + sizeof(FontFileHeader)); }
+	bool setData(uint8_t *fontData, size_t fontSize, bool canWrite, const char *name);
+	bool validate() const;
+
+	MappedFile file;
+	std::vector<uint8_t> convertedData;
+};
+
+// Builds v2 font in memory from headerless 8x12 .dat data.
+bool convertLegacyFont(const uint8_t *legacyData, size_t legacySize, std::vector<uint8_t> &fontOut);
+
+}; // end of core namespace.
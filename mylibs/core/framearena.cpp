@@ -0,0 +1,91 @@
+#include "framearena.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <cassert>
+
+namespace core {
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1u) & ~(alignment - 1u);
+}
+
+FrameArena::FrameArena(size_t capacity)
+{
+	this->capacity = capacity;
+	data = new uint8_t[ capacity ];
+}
+
+FrameArena::~FrameArena()
+{
+	reset();
+	delete[] data;
+	data = nullptr;
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+	assert(alignment > 0u && (alignment & (alignment - 1u)) == 0u && "Arena alignment has to be power of two");
+
+	// Blocks come from new, they are aligned to at least 16.
+	size_t start = alignUp(used, alignment);
+	if(start + size <= capacity)
+	{
+		used = start + size;
+		return data + start;
+	}
+
+	start = alignUp(overflowPos, alignment);
+	if(!overflowData || start + size > overflowCapacity)
+	{
+		overflowCapacity = size + alignment > capacity ? size + alignment : capacity;
+		overflowData = new uint8_t[ overflowCapacity ];
+		overflowBlocks.push_back(overflowData);
+		overflowPos = 0u;
+		start = 0u;
+	}
+	overflowUsed += start + size - overflowPos;
+	overflowPos = start + size;
+	return overflowData + start;
+}
+
+const char *FrameArena::format(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	va_list argsCopy;
+	va_copy(argsCopy, args);
+	int length = vsnprintf(nullptr, 0, format, argsCopy);
+	va_end(argsCopy);
+
+	char *str = (char *)allocate(size_t(length > 0 ? length : 0) + 1u, 1u);
+	vsnprintf(str, size_t(length > 0 ? length : 0) + 1u, format, args);
+	va_end(args);
+	return str;
+}
+
+void FrameArena::reset()
+{
+	size_t frameUsed = getUsed();
+	highWater = frameUsed > highWater ? frameUsed : highWater;
+	used = 0u;
+
+	if(overflowBlocks.empty())
+		return;
+
+	for(uint8_t *block : overflowBlocks)
+		delete[] block;
+	overflowBlocks.clear();
+	overflowData = nullptr;
+	overflowCapacity = 0u;
+	overflowPos = 0u;
+	overflowUsed = 0u;
+
+	// Grow so the busiest frame so far fits, with room to spare.
+	capacity = alignUp(highWater + highWater / 2u, 4096u);
+	delete[] data;
+	data = new uint8_t[ capacity ];
+}
+
+}; // end of core namespace.
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace core
+{
+
+// Bump allocator for memory that only lives until the end of the frame, reset gives it all back at once.
+// Allocations that don't fit go into extra blocks, reset replaces them with one block big enough for the
+// busiest frame so far, so after a few frames the arena stops touching the heap. Not thread safe, and the
+// memory must not go into frame packets, the render thread reads those after the reset.
+class FrameArena
+{
+public:
+	explicit FrameArena(size_t capacity = 1024u * 1024u);
+	~FrameArena();
+	FrameArena(const FrameArena &) = delete;
+	FrameArena &operator=(const FrameArena &) = delete;
+
+	// alignment has to be power of two.
+	void *allocate(size_t size, size_t alignment = 16u);
+	template <typename T>
+	T *allocateArray(size_t count) { return (T *)allocate(count * sizeof(T), alignof(T)); }
+	// printf into the arena, returns null terminated string.
+	const char *format(const char *format, ...);
+
+	void reset();
+
+	size_t getCapacity() const { return capacity; }
+	// Bytes used this frame, including the extra blocks.
+	size_t getUsed() const { return used + overflowUsed; }
+	// Most bytes any frame has used.
+	size_t highWater = 0u;
+
+private:
+	uint8_t *data = nullptr;
+	size_t capacity = 0u;
+	size_t used = 0u;
+
+	std::vector<uint8_t *> overflowBlocks;
+	uint8_t *overflowData = nullptr;
+	size_t overflowCapacity = 0u;
+	size_t overflowPos = 0u;
+	size_t overflowUsed = 0u;
+};
+
+// Std allocator on top of FrameArena, deallocate does nothing. Containers have to be gone before reset.
+template <typename T>
+struct ArenaAllocator
+{
+	using value_type = T;
+
+	ArenaAllocator(FrameArena &arena) : arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+	T *allocate(size_t count) { return arena->allocateArray<T>(count); }
+	void deallocate(T *, size_t) {}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+
+	FrameArena *arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+}; // end of core namespace.
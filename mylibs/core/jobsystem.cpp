@@ -0,0 +1,168 @@
+#include "jobsystem.h"
+
+#include <stdio.h>
+
+namespace core {
+
+// Index of the queue owned by current thread, main thread and any other non-worker thread use 0.
+static thread_local uint32_t currentThreadIndex = 0u;
+
+bool JobSystem::init(uint32_t workerCount)
+{
+	if(workerCount == 0u)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1u ? hardwareThreads - 1u : 0u;
+	}
+
+	queues.resize(workerCount + 1u);
+	for(JobQueue *&queue : queues)
+	{
+		queue = new JobQueue();
+		queue->jobs.reserve(256);
+	}
+
+	workers.reserve(workerCount);
+	for(uint32_t i = 0; i < workerCount; ++i)
+		workers.emplace_back(&JobSystem::workerLoop, this, i + 1u);
+
+	printf("Job system threads: %u\n", workerCount + 1u);
+	return true;
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		quit = true;
+	}
+	sleepCondition.notify_all();
+
+	for(std::thread &worker : workers)
+		worker.join();
+	workers.clear();
+
+	for(JobQueue *queue : queues)
+		delete queue;
+	queues.clear();
+}
+
+uint32_t JobSystem::getThreadIndex() const
+{
+	return currentThreadIndex < queues.size() ? currentThreadIndex : 0u;
+}
+
+void JobSystem::addJob(const Job &job)
+{
+	if(job.counter)
+		job.counter->count.fetch_add(1u);
+
+	if(workers.empty())
+	{
+		runJob(job);
+		return;
+	}
+
+	JobQueue &queue = *queues[getThreadIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+
+	queuedJobs.fetch_add(1u);
+	{
+		// Lock so a worker cannot check queuedJobs and go to sleep in between.
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+}
+
+bool JobSystem::popJob(uint32_t threadIndex, Job &outJob)
+{
+	JobQueue &queue = *queues[threadIndex];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if(queue.front >= queue.jobs.size())
+		return false;
+
+	outJob = queue.jobs.back();
+	queue.jobs.pop_back();
+	if(queue.front >= queue.jobs.size())
+	{
+		queue.jobs.clear();
+		queue.front = 0u;
+	}
+	return true;
+}
+
+bool JobSystem::stealJob(uint32_t threadIndex, Job &outJob)
+{
+	uint32_t queueCount = uint32_t(queues.size());
+	for(uint32_t i = 1; i < queueCount; ++i)
+	{
+		JobQueue &queue = *queues[(threadIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(queue.front >= queue.jobs.size())
+			continue;
+
+		outJob = queue.jobs[queue.front];
+		++queue.front;
+		if(queue.front >= queue.jobs.size())
+		{
+			queue.jobs.clear();
+			queue.front = 0u;
+		}
+		return true;
+	}
+	return false;
+}
+
+bool JobSystem::findJob(uint32_t threadIndex, Job &outJob)
+{
+	if(popJob(threadIndex, outJob) || stealJob(threadIndex, outJob))
+	{
+		queuedJobs.fetch_sub(1u);
+		return true;
+	}
+	return false;
+}
+
+void JobSystem::runJob(const Job &job)
+{
+	job.func(job.data, job.start, job.end);
+	if(job.counter)
+		job.counter->count.fetch_sub(1u, std::memory_order_release);
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+	uint32_t threadIndex = getThreadIndex();
+	while(counter.count.load(std::memory_order_acquire) > 0u)
+	{
+		Job job;
+		if(findJob(threadIndex, job))
+			runJob(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex)
+{
+	currentThreadIndex = threadIndex;
+	while(true)
+	{
+		Job job;
+		if(findJob(threadIndex, job))
+		{
+			runJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this]() { return quit || queuedJobs.load() > 0u; });
+		if(quit)
+			return;
+	}
+}
+
+}; // end of core namespace.
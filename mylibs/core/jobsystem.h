@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core
+{
+
+// Counts unfinished jobs, wait on it with JobSystem::wait.
+struct JobCounter
+{
+	std::atomic<uint32_t> count = 0u;
+};
+
+struct Job
+{
+	// Runs indices [start, end).
+	void (*func)(void *data, uint32_t start, uint32_t end) = nullptr;
+	void *data = nullptr;
+	uint32_t start = 0u;
+	uint32_t end = 0u;
+	JobCounter *counter = nullptr;
+};
+
+// Work stealing job system. Every thread has its own deque, owner pushes and pops from the back,
+// idle threads steal from the front of the others. The thread calling wait runs jobs while it waits.
+class JobSystem
+{
+public:
+	// workerCount 0 uses hardware threads - 1 workers, main thread is the extra one.
+	bool init(uint32_t workerCount = 0u);
+	~JobSystem();
+
+	// Increments job.counter, the job decrements it once it has run.
+	void addJob(const Job &job);
+	void wait(JobCounter &counter);
+
+	// Splits [0, count) into batches of batchSize and runs func(start, end) on every batch, returns when all are done.
+	template <typename Func>
+	void parallelFor(uint32_t count, uint32_t batchSize, const Func &func);
+
+	// Worker threads + the main thread.
+	uint32_t getThreadCount() const { return uint32_t(queues.size()); }
+
+private:
+	struct JobQueue
+	{
+		std::mutex mutex;
+		std::vector<Job> jobs;
+		// Front of the queue for stealing, jobs before it are already taken.
+		uint32_t front = 0u;
+	};
+
+	void workerLoop(uint32_t threadIndex);
+	bool popJob(uint32_t threadIndex, Job &outJob);
+	bool stealJob(uint32_t threadIndex, Job &outJob);
+	bool findJob(uint32_t threadIndex, Job &outJob);
+	void runJob(const Job &job);
+	uint32_t getThreadIndex() const;
+
+	std::vector<JobQueue *> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::atomic<uint32_t> queuedJobs = 0u;
+	std::atomic<bool> quit = false;
+};
+
+template <typename Func>
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const Func &func)
+{
+	if(count == 0u)
+		return;
+	if(batchSize == 0u)
+		batchSize = 1u;
+
+	// Nothing to split, skip the queues.
+	if(count <= batchSize || workers.empty())
+	{
+		func(0u, count);
+		return;
+	}
+
+	JobCounter counter;
+	Job job;
+	job.func = [](void *data, uint32_t start, uint32_t end)
+	{
+		(*(const Func *)data)(start, end);
+	};
+	job.data = (void *)&func;
+	job.counter = &counter;
+
+	uint32_t batchCount = (count + batchSize - 1u) / batchSize;
+	for(uint32_t i = 0; i < batchCount; ++i)
+	{
+		job.start = i * batchSize;
+		job.end = job.start + batchSize < count ? job.start + batchSize : count;
+		addJob(job);
+	}
+	wait(counter);
+}
+
+};
@@ -0,0 +1,96 @@
+#include "mappedfile.h"
+
+#include <stdio.h>
+
+#if _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace core {
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string &fileName, bool copyOnWrite)
+{
+	close();
+
+	void *mappedPtr = nullptr;
+#if _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = size_t(fileSize.QuadPart);
+	fileHandle = file;
+
+	if(size > 0u)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+		mappingHandle = mapping;
+		if(mapping)
+			mappedPtr = MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	int file = ::open(fileName.c_str(), O_RDONLY);
+	if(file < 0)
+		return false;
+
+	struct stat fileStat;
+	fstat(file, &fileStat);
+	size = size_t(fileStat.st_size);
+
+	if(size > 0u)
+	{
+		// Private mapping, writes go to own copy of the touched pages.
+		void *ptr = mmap(nullptr, size, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, file, 0);
+		mappedPtr = ptr != MAP_FAILED ? ptr : nullptr;
+	}
+	::close(file);
+#endif
+
+	if(size > 0u && !mappedPtr)
+	{
+		printf("Failed to map file: %s\n", fileName.c_str());
+		close();
+		return false;
+	}
+
+	data = (uint8_t *)mappedPtr;
+	opened = true;
+	return true;
+}
+
+void MappedFile::close()
+{
+#if _WIN32
+	if(data)
+		UnmapViewOfFile(data);
+	if(mappingHandle)
+		CloseHandle(HANDLE(mappingHandle));
+	if(fileHandle)
+		CloseHandle(HANDLE(fileHandle));
+#else
+	if(data)
+		munmap(data, size);
+#endif
+	data = nullptr;
+	size = 0u;
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+	opened = false;
+}
+
+}; // end of core namespace.
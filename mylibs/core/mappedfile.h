@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+namespace core
+{
+
+// Memory mapped view of a whole file, mmap or MapViewOfFile.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	// copyOnWrite maps the file privately writable, writes never go to the file. Empty files open
+	// with nullptr data.
+	bool open(const std::string &fileName, bool copyOnWrite = false);
+	void close();
+	bool isOpen() const { return opened; }
+
+	uint8_t *data = nullptr;
+	size_t size = 0u;
+
+private:
+	void *fileHandle = nullptr;
+	void *mappingHandle = nullptr;
+	bool opened = false;
+};
+
+}; // end of core namespace.
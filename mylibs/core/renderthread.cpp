@@ -0,0 +1,122 @@
+#include "renderthread.h"
+
+#include "app.h"
+
+#include <stdio.h>
+#include <cassert>
+#include <chrono>
+
+namespace core {
+
+RenderThread::~RenderThread()
+{
+	stop();
+}
+
+bool RenderThread::startThread(App &newApp, uint32_t newPacketCount)
+{
+	assert(!thread.joinable() && "Render thread is already running");
+	assert(newPacketCount > 0u && newPacketCount <= MaxPackets && "Render thread packet count out of range");
+
+	app = &newApp;
+	packetCount = newPacketCount;
+	submittedPackets = 0u;
+	renderedPackets = 0u;
+	contextState = 0u;
+	quit = false;
+
+	if(!app->setContextCurrent(false))
+		return false;
+
+	thread = std::thread(&RenderThread::renderLoop, this);
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return contextState != 0u; });
+	}
+
+	if(contextState != 1u)
+	{
+		printf("Render thread failed to get GL context\n");
+		thread.join();
+		app->setContextCurrent(true);
+		return false;
+	}
+	printf("Render thread started, %u frame packets\n", packetCount);
+	return true;
+}
+
+void RenderThread::stop()
+{
+	if(!thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	condition.notify_all();
+	thread.join();
+	app->setContextCurrent(true);
+}
+
+uint32_t RenderThread::beginPacket()
+{
+	assert(thread.joinable() && "Render thread is not running");
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	std::unique_lock<std::mutex> lock(mutex);
+	condition.wait(lock, [this]() { return submittedPackets - renderedPackets < packetCount; });
+	packetStartTime = std::chrono::high_resolution_clock::now();
+	packetWaitMs = std::chrono::duration<float, std::milli>(packetStartTime - startTime).count();
+	return uint32_t(submittedPackets % packetCount);
+}
+
+void RenderThread::submitPacket()
+{
+	// Packet i is rendered as frame i, and only the main thread changes submittedPackets.
+	float mainMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - packetStartTime).count();
+	app->setMainFrameTime(uint32_t(submittedPackets), mainMs, packetWaitMs);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++submittedPackets;
+	}
+	condition.notify_all();
+}
+
+void RenderThread::renderLoop()
+{
+	bool hasContext = app->setContextCurrent(true);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		contextState = hasContext ? 1u : 2u;
+	}
+	condition.notify_all();
+	if(!hasContext)
+		return;
+
+	while(true)
+	{
+		uint32_t packetIndex = 0u;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return renderedPackets < submittedPackets || quit; });
+			// Quit only once every submitted packet is rendered.
+			if(renderedPackets == submittedPackets)
+				break;
+			packetIndex = uint32_t(renderedPackets % packetCount);
+		}
+
+		app->beginFrame();
+		renderFunc(renderData, packetIndex);
+		app->endFrame();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			++renderedPackets;
+		}
+		condition.notify_all();
+	}
+	app->setContextCurrent(false);
+}
+
+}; // end of core namespace.
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace core
+{
+
+class App;
+
+// Moves GL submission and swap onto a thread of its own, which owns the GL context while running. The main
+// thread fills frame packets, plain data like instances, quads and uniform values, and the render thread
+// turns them into GL calls in submit order, so the main thread builds frame N + 1 while frame N gets
+// submitted and swapped. With packetCount packets the main thread runs at most packetCount - 1 frames ahead.
+// GL objects are created and destroyed on the main thread while the render thread is stopped.
+class RenderThread
+{
+public:
+	static constexpr uint32_t MaxPackets = 3u;
+
+	~RenderThread();
+
+	// Releases the context from the calling thread and makes it current on the render thread, which calls
+	// renderPacket(packetIndex) for every submitted packet between app.beginFrame and app.endFrame.
+	// renderPacket has to outlive the thread.
+	template <typename Func>
+	bool start(App &app, uint32_t packetCount, const Func &renderPacket);
+
+	// Waits until the render thread is done with the next packet and returns its index. Whatever the render
+	// thread wrote into the packet while rendering it is safe to read from here on.
+	uint32_t beginPacket();
+	// Hands the packet from beginPacket over to the render thread. Time since beginPacket returned and the
+	// wait inside it go into app frame timings.
+	void submitPacket();
+	// Renders the packets still queued, joins the thread and makes the context current on the calling thread.
+	void stop();
+
+	bool isRunning() const { return thread.joinable(); }
+
+private:
+	bool startThread(App &app, uint32_t packetCount);
+	void renderLoop();
+
+	void (*renderFunc)(void *data, uint32_t packetIndex) = nullptr;
+	void *renderData = nullptr;
+	App *app = nullptr;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable condition;
+	// Packets are used round robin, packet of frame i is i % packetCount.
+	uint64_t submittedPackets = 0u;
+	uint64_t renderedPackets = 0u;
+	uint32_t packetCount = 0u;
+	// Main thread only, when the last beginPacket returned and how long it waited.
+	std::chrono::high_resolution_clock::time_point packetStartTime;
+	float packetWaitMs = 0.0f;
+	// 0 while render thread is starting, 1 when it has the context, 2 when it failed to get it.
+	uint32_t contextState = 0u;
+	bool quit = false;
+};
+
+template <typename Func>
+bool RenderThread::start(App &app, uint32_t packetCount, const Func &renderPacket)
+{
+	renderFunc = [](void *data, uint32_t packetIndex)
+	{
+		(*(const Func *)data)(packetIndex);
+	};
+	renderData = (void *)&renderPacket;
+	return startThread(app, packetCount);
+}
+
+}; // end of core namespace.
@@ -0,0 +1,221 @@
+#include "sdfbaker.h"
+
+#include "fontfile.h"
+#include "jobsystem.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+namespace core {
+
+static constexpr uint32_t SdfCacheMagic = 0x46445348u; // "HSDF"
+static constexpr uint32_t SdfCacheVersion = 1u;
+
+struct SdfCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t cellWidth;
+	uint32_t cellHeight;
+	uint32_t glyphCount;
+	uint32_t columns;
+	uint32_t padding;
+	uint32_t texelsPerPixel;
+	uint64_t hash;
+};
+
+static bool isPixelSet(const uint8_t *glyph, uint32_t rowBytes, int x, int y, int glyphWidth, int glyphHeight)
+{
+	if(x < 0 || y < 0 || x >= glyphWidth || y >= glyphHeight)
+		return false;
+	return ((glyph[ y * rowBytes + x / 8 ] >> (x % 8)) & 1) != 0;
+}
+
+void bakeSdfGlyph(const uint8_t *glyph, const FontSizeInfo &sizeInfo, const SdfBakeParams &params,
+	uint8_t *outTexels, uint32_t outRowTexels)
+{
+	int glyphWidth = int(sizeInfo.glyphWidth);
+	int glyphHeight = int(sizeInfo.glyphHeight);
+	uint32_t rowBytes = (sizeInfo.glyphWidth + 7u) / 8u;
+	float texelSize = 1.0f / float(params.texelsPerPixel);
+	float spread = float(params.padding) * texelSize;
+
+	uint32_t cellWidth = sizeInfo.glyphWidth * params.texelsPerPixel + params.padding * 2u;
+	uint32_t cellHeight = sizeInfo.glyphHeight * params.texelsPerPixel + params.padding * 2u;
+	for(uint32_t y = 0; y < cellHeight; ++y)
+	{
+		for(uint32_t x = 0; x < cellWidth; ++x)
+		{
+			// Texel center in font pixels.
+			float fx = (float(x) + 0.5f) * texelSize - spread;
+			float fy = (float(y) + 0.5f) * texelSize - spread;
+			bool inside = isPixelSet(glyph, rowBytes, int(floorf(fx)), int(floorf(fy)), glyphWidth, glyphHeight);
+
+			// Distance to the closest pixel square with the other state, only pixels closer than spread
+			// matter. Pixels just outside the glyph count as unset, so inside texels always find an edge.
+			int minX = int(floorf(fx - spread)) > -1 ? int(floorf(fx - spread)) : -1;
+			int minY = int(floorf(fy - spread)) > -1 ? int(floorf(fy - spread)) : -1;
+			int maxX = int(floorf(fx + spread)) < glyphWidth ? int(floorf(fx + spread)) : glyphWidth;
+			int maxY = int(floorf(fy + spread)) < glyphHeight ? int(floorf(fy + spread)) : glyphHeight;
+
+			float closest = spread * spread;
+			for(int py = minY; py <= maxY; ++py)
+			{
+				for(int px = minX; px <= maxX; ++px)
+				{
+					if(isPixelSet(glyph, rowBytes, px, py, glyphWidth, glyphHeight) == inside)
+						continue;
+
+					float dx = fmaxf(fabsf(fx - (float(px) + 0.5f)) - 0.5f, 0.0f);
+					float dy = fmaxf(fabsf(fy - (float(py) + 0.5f)) - 0.5f, 0.0f);
+					closest = fminf(closest, dx * dx + dy * dy);
+				}
+			}
+
+			float distance = sqrtf(closest) / spread;
+			float value = 0.5f + (inside ? distance : -distance) * 0.5f;
+			value = fmaxf(0.0f, fminf(value, 1.0f));
+			outTexels[ y * outRowTexels + x ] = uint8_t(value * 255.0f + 0.5f);
+		}
+	}
+}
+
+bool bakeSdfAtlas(const FontFile &font, uint32_t sizeIndex, const SdfBakeParams &params, JobSystem *jobSystem,
+	SdfAtlas &outAtlas)
+{
+	if(params.texelsPerPixel == 0u || params.padding == 0u || params.columns == 0u)
+	{
+		printf("Sdf bake params need texels per pixel, padding and columns\n");
+		return false;
+	}
+
+	const FontSizeInfo &sizeInfo = font.getSize(sizeIndex);
+	outAtlas.glyphCount = uint32_t(sizeInfo.lastChar) - uint32_t(sizeInfo.firstChar) + 1u;
+	outAtlas.columns = params.columns;
+	outAtlas.padding = params.padding;
+	outAtlas.texelsPerPixel = params.texelsPerPixel;
+	outAtlas.cellWidth = sizeInfo.glyphWidth * params.texelsPerPixel + params.padding * 2u;
+	outAtlas.cellHeight = sizeInfo.glyphHeight * params.texelsPerPixel + params.padding * 2u;
+	outAtlas.width = outAtlas.cellWidth * params.columns;
+	outAtlas.height = outAtlas.cellHeight * ((outAtlas.glyphCount + params.columns - 1u) / params.columns);
+	outAtlas.texels.assign(size_t(outAtlas.width) * outAtlas.height, 0u);
+
+	const uint8_t *glyphData = font.getGlyphData(sizeIndex);
+	auto bakeGlyphs = [&](uint32_t start, uint32_t end)
+	{
+		for(uint32_t i = start; i < end; ++i)
+		{
+			uint32_t cellX = (i % outAtlas.columns) * outAtlas.cellWidth;
+			uint32_t cellY = (i / outAtlas.columns) * outAtlas.cellHeight;
+			bakeSdfGlyph(glyphData + i * sizeInfo.bytesPerGlyph, sizeInfo, params,
+				outAtlas.texels.data() + cellY * outAtlas.width + cellX, outAtlas.width);
+		}
+	};
+
+	// Glyphs write only into their own cell, so they can bake in any order.
+	if(jobSystem)
+		jobSystem->parallelFor(outAtlas.glyphCount, 4u, bakeGlyphs);
+	else
+		bakeGlyphs(0u, outAtlas.glyphCount);
+	return true;
+}
+
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+	// FNV-1a
+	for(size_t i = 0; i < size; ++i)
+	{
+		hash ^= uint64_t(((const uint8_t *)data)[ i ]);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static uint64_t getSdfCacheHash(const FontFile &font, uint32_t sizeIndex, const SdfBakeParams &params)
+{
+	const FontSizeInfo &sizeInfo = font.getSize(sizeIndex);
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = hashBytes(hash, &SdfCacheVersion, sizeof(SdfCacheVersion));
+	hash = hashBytes(hash, &params, sizeof(SdfBakeParams));
+	hash = hashBytes(hash, &sizeInfo.glyphWidth, sizeof(sizeInfo.glyphWidth));
+	hash = hashBytes(hash, &sizeInfo.glyphHeight, sizeof(sizeInfo.glyphHeight));
+	hash = hashBytes(hash, &sizeInfo.bytesPerGlyph, sizeof(sizeInfo.bytesPerGlyph));
+	hash = hashBytes(hash, font.getGlyphData(sizeIndex), font.getGlyphDataSize(sizeIndex));
+	return hash;
+}
+
+static bool loadSdfCache(const std::filesystem::path &p, uint64_t hash, SdfAtlas &outAtlas)
+{
+	FILE *file = fopen(p.string().c_str(), "rb");
+	if(!file)
+		return false;
+
+	SdfCacheHeader header = {};
+	bool success = fread(&header, sizeof(header), 1, file) == 1 && header.magic == SdfCacheMagic &&
+		header.version == SdfCacheVersion && header.hash == hash;
+	if(success)
+	{
+		outAtlas.width = header.width;
+		outAtlas.height = header.height;
+		outAtlas.cellWidth = header.cellWidth;
+		outAtlas.cellHeight = header.cellHeight;
+		outAtlas.glyphCount = header.glyphCount;
+		outAtlas.columns = header.columns;
+		outAtlas.padding = header.padding;
+		outAtlas.texelsPerPixel = header.texelsPerPixel;
+		outAtlas.texels.resize(size_t(header.width) * header.height);
+		success = fread(outAtlas.texels.data(), 1, outAtlas.texels.size(), file) == outAtlas.texels.size();
+	}
+	fclose(file);
+	return success;
+}
+
+static void saveSdfCache(const std::filesystem::path &p, uint64_t hash, const SdfAtlas &atlas)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(p.parent_path(), ec);
+
+	SdfCacheHeader header{ .magic = SdfCacheMagic, .version = SdfCacheVersion, .width = atlas.width,
+		.height = atlas.height, .cellWidth = atlas.cellWidth, .cellHeight = atlas.cellHeight,
+		.glyphCount = atlas.glyphCount, .columns = atlas.columns, .padding = atlas.padding,
+		.texelsPerPixel = atlas.texelsPerPixel, .hash = hash };
+
+	FILE *file = fopen(p.string().c_str(), "wb");
+	bool success = file && fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(atlas.texels.data(), 1, atlas.texels.size(), file) == atlas.texels.size();
+	if(file)
+		fclose(file);
+	if(!success)
+		printf("Failed to write sdf cache file: %s\n", p.string().c_str());
+}
+
+bool loadOrBakeSdfAtlas(const FontFile &font, uint32_t sizeIndex, const SdfBakeParams &params, JobSystem *jobSystem,
+	const char *cacheDirectory, SdfAtlas &outAtlas)
+{
+	uint64_t hash = getSdfCacheHash(font, sizeIndex, params);
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.sdf", (unsigned long long)hash);
+	std::filesystem::path p = std::filesystem::path(cacheDirectory) / name;
+
+	auto startTime = std::chrono::high_resolution_clock::now();
+	if(loadSdfCache(p, hash, outAtlas))
+	{
+		float loadMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+		printf("Sdf cache hit: %s, load: %2.3fms\n", p.string().c_str(), loadMs);
+		return true;
+	}
+
+	if(!bakeSdfAtlas(font, sizeIndex, params, jobSystem, outAtlas))
+		return false;
+
+	float bakeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	printf("Sdf cache miss: %s, bake: %2.3fms\n", p.string().c_str(), bakeMs);
+	saveSdfCache(p, hash, outAtlas);
+	return true;
+}
+
+}; // end of core namespace.
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace core
+{
+
+class FontFile;
+class JobSystem;
+struct FontSizeInfo;
+
+struct SdfBakeParams
+{
+	// Atlas texels per font pixel.
+	uint32_t texelsPerPixel = 4u;
+	// Empty texels around every glyph, also the distance range: padding texels from the edge is 0 or 255.
+	uint32_t padding = 4u;
+	uint32_t columns = 16u;
+};
+
+// One R8 distance field cell per glyph, 128 is the glyph edge, bigger values are inside. Cell rows go
+// from bottom to top like the font rows, glyph i is in column i % columns, row i / columns.
+struct SdfAtlas
+{
+	uint32_t width = 0u;
+	uint32_t height = 0u;
+	uint32_t cellWidth = 0u;
+	uint32_t cellHeight = 0u;
+	uint32_t glyphCount = 0u;
+	uint32_t columns = 0u;
+	uint32_t padding = 0u;
+	uint32_t texelsPerPixel = 0u;
+	std::vector<uint8_t> texels;
+};
+
+// Bakes one glyph into a cell of glyphWidth * texelsPerPixel + 2 * padding times glyphHeight * texelsPerPixel
+// + 2 * padding texels. outRowTexels is the row pitch of outTexels.
+void bakeSdfGlyph(const uint8_t *glyph, const FontSizeInfo &sizeInfo, const SdfBakeParams &params,
+	uint8_t *outTexels, uint32_t outRowTexels);
+// Bakes every glyph of the font size, glyphs are split between jobSystem threads. jobSystem can be nullptr.
+bool bakeSdfAtlas(const FontFile &font, uint32_t sizeIndex, const SdfBakeParams &params, JobSystem *jobSystem,
+	SdfAtlas &outAtlas);
+// Loads the atlas from cacheDirectory if the font data and params match, otherwise bakes and saves it there.
+bool loadOrBakeSdfAtlas(const FontFile &font, uint32_t sizeIndex, const SdfBakeParams &params, JobSystem *jobSystem,
+	const char *cacheDirectory, SdfAtlas &outAtlas);
+
+}; // end of core namespace.
@@ -0,0 +1,108 @@
+#include "slotmap.h"
+
+#include <cassert>
+
+namespace core {
+
+SlotHandle SlotMap::add()
+{
+	uint32_t slot = freeSlot;
+	if(slot != InvalidIndex)
+	{
+		freeSlot = slots[ slot ].index;
+	}
+	else
+	{
+		slot = uint32_t(slots.size());
+		slots.push_back(Slot{ .index = InvalidIndex, .generation = 1u });
+	}
+
+	uint32_t index = uint32_t(denseSlots.size());
+	slots[ slot ].index = index;
+	denseSlots.push_back(slot);
+	markDirty(index);
+	return SlotHandle{ .slot = slot, .generation = slots[ slot ].generation };
+}
+
+uint32_t SlotMap::remove(SlotHandle handle)
+{
+	uint32_t index = getIndex(handle);
+	if(index != InvalidIndex)
+		removeAt(index);
+	return index;
+}
+
+void SlotMap::removeAt(uint32_t index)
+{
+	assert(index < denseSlots.size() && "Slot map index out of range");
+
+	// Generation bump invalidates every handle to the removed item.
+	uint32_t slot = denseSlots[ index ];
+	++slots[ slot ].generation;
+	slots[ slot ].index = freeSlot;
+	freeSlot = slot;
+
+	uint32_t lastIndex = uint32_t(denseSlots.size()) - 1u;
+	if(index != lastIndex)
+	{
+		uint32_t movedSlot = denseSlots[ lastIndex ];
+		denseSlots[ index ] = movedSlot;
+		slots[ movedSlot ].index = index;
+		markDirty(index);
+	}
+	denseSlots.pop_back();
+
+	// Items past the end are gone, they don't need patching.
+	if(dirtyEnd > lastIndex)
+		dirtyEnd = lastIndex;
+	if(dirtyBegin >= dirtyEnd)
+		clearDirty();
+}
+
+void SlotMap::clear()
+{
+	// Slots stay allocated so old handles keep failing.
+	for(uint32_t index = uint32_t(denseSlots.size()); index > 0u; --index)
+		removeAt(index - 1u);
+	clearDirty();
+}
+
+void SlotMap::reserve(uint32_t count)
+{
+	slots.reserve(count);
+	denseSlots.reserve(count);
+}
+
+uint32_t SlotMap::getIndex(SlotHandle handle) const
+{
+	if(handle.slot >= slots.size() || slots[ handle.slot ].generation != handle.generation)
+		return InvalidIndex;
+	return slots[ handle.slot ].index;
+}
+
+SlotHandle SlotMap::getHandle(uint32_t index) const
+{
+	assert(index < denseSlots.size() && "Slot map index out of range");
+	uint32_t slot = denseSlots[ index ];
+	return SlotHandle{ .slot = slot, .generation = slots[ slot ].generation };
+}
+
+void SlotMap::clearDirty()
+{
+	dirtyBegin = 0u;
+	dirtyEnd = 0u;
+}
+
+void SlotMap::markDirty(uint32_t index)
+{
+	if(dirtyBegin >= dirtyEnd)
+	{
+		dirtyBegin = index;
+		dirtyEnd = index + 1u;
+		return;
+	}
+	dirtyBegin = index < dirtyBegin ? index : dirtyBegin;
+	dirtyEnd = index + 1u > dirtyEnd ? index + 1u : dirtyEnd;
+}
+
+}; // end of core namespace.
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace core
+{
+
+struct SlotHandle
+{
+	uint32_t slot = ~0u;
+	uint32_t generation = 0u;
+};
+
+// Generational handles to densely packed items. SlotMap only maps handles to dense indices, the owner keeps
+// the item data in its own arrays, usually structure of arrays, indexed by dense index. Removing moves the
+// last item into the hole, so items stay packed and loops run over [0, getCount()) without gaps. A removed
+// item's handle never becomes valid again, reusing its slot bumps the generation.
+class SlotMap
+{
+public:
+	static constexpr uint32_t InvalidIndex = ~0u;
+
+	// New item gets dense index getCount() - 1.
+	SlotHandle add();
+	// Returns the dense index the removed item had, or InvalidIndex for a stale handle. The owner has to move
+	// its last item into the returned index and drop the last one, same as for removeAt.
+	uint32_t remove(SlotHandle handle);
+	// Removes item at dense index, last item moves into its place.
+	void removeAt(uint32_t index);
+	void clear();
+	// Room for count items, so adds up to it don't allocate.
+	void reserve(uint32_t count);
+
+	// InvalidIndex for stale handles.
+	uint32_t getIndex(SlotHandle handle) const;
+	bool isValid(SlotHandle handle) const { return getIndex(handle) != InvalidIndex; }
+	SlotHandle getHandle(uint32_t index) const;
+	uint32_t getCount() const { return uint32_t(denseSlots.size()); }
+
+	// Dense range [dirtyBegin, dirtyEnd) changed since the last clearDirty, from added items and items moved
+	// by removes. Copies of the dense arrays, like gpu buffers, only need this range patched and their count
+	// cut to getCount().
+	bool isDirty() const { return dirtyBegin < dirtyEnd; }
+	void clearDirty();
+
+	uint32_t dirtyBegin = 0u;
+	uint32_t dirtyEnd = 0u;
+
+private:
+	struct Slot
+	{
+		// Dense index while in use, next free slot while free.
+		uint32_t index;
+		uint32_t generation;
+	};
+
+	void markDirty(uint32_t index);
+
+	std::vector<Slot> slots;
+	std::vector<uint32_t> denseSlots;
+	uint32_t freeSlot = InvalidIndex;
+};
+
+}; // end of core namespace.
@@ -0,0 +1,66 @@
+#include "utf8.h"
+
+namespace core {
+
+uint32_t decodeUtf8(const char *text, uint32_t length, uint32_t &index)
+{
+	uint8_t lead = uint8_t(text[ index ]);
+	if(lead < 0x80u)
+	{
+		++index;
+		return lead;
+	}
+
+	uint32_t count = 0u;
+	uint32_t codePoint = 0u;
+	uint32_t minCodePoint = 0u;
+	if((lead & 0xE0u) == 0xC0u)
+	{
+		count = 1u;
+		codePoint = lead & 0x1Fu;
+		minCodePoint = 0x80u;
+	}
+	else if((lead & 0xF0u) == 0xE0u)
+	{
+		count = 2u;
+		codePoint = lead & 0x0Fu;
+		minCodePoint = 0x800u;
+	}
+	else if((lead & 0xF8u) == 0xF0u)
+	{
+		count = 3u;
+		codePoint = lead & 0x07u;
+		minCodePoint = 0x10000u;
+	}
+	else
+	{
+		++index;
+		return Utf8ReplacementChar;
+	}
+
+	if(count >= length - index)
+	{
+		++index;
+		return Utf8ReplacementChar;
+	}
+	for(uint32_t i = 1; i <= count; ++i)
+	{
+		uint8_t c = uint8_t(text[ index + i ]);
+		if((c & 0xC0u) != 0x80u)
+		{
+			++index;
+			return Utf8ReplacementChar;
+		}
+		codePoint = (codePoint << 6u) | (c & 0x3Fu);
+	}
+
+	if(codePoint < minCodePoint || codePoint > 0x10FFFFu || (codePoint >= 0xD800u && codePoint <= 0xDFFFu))
+	{
+		++index;
+		return Utf8ReplacementChar;
+	}
+	index += count + 1u;
+	return codePoint;
+}
+
+}; // end of core namespace.
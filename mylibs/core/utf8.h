@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace core
+{
+
+static constexpr uint32_t Utf8ReplacementChar = 0xFFFDu;
+
+// Decodes one code point starting at text[ index ] and moves index past it. Invalid, overlong or cut
+// sequences and surrogates give Utf8ReplacementChar and skip one byte, so decoding always moves forward.
+uint32_t decodeUtf8(const char *text, uint32_t length, uint32_t &index);
+
+}; // end of core namespace.
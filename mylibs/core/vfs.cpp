@@ -0,0 +1,207 @@
+#include "vfs.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+namespace core {
+
+static constexpr uint64_t AssetDataAlignment = 16u;
+
+uint64_t hashAssetPath(std::string_view path)
+{
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for(char c : path)
+	{
+		hash ^= uint64_t(uint8_t(c == '\\' ? '/' : c));
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static bool writeZeros(FILE *file, uint64_t count)
+{
+	static const uint8_t zeros[ AssetDataAlignment ] = {};
+	return count == 0u || fwrite(zeros, 1, size_t(count), file) == size_t(count);
+}
+
+bool writeAssetArchive(const std::string &fileName, const std::vector<AssetArchiveInput> &files)
+{
+	std::vector<AssetArchiveEntry> archiveEntries(files.size());
+	std::vector<uint32_t> order(files.size());
+	for(uint32_t i = 0; i < uint32_t(files.size()); ++i)
+	{
+		archiveEntries[ i ].pathHash = hashAssetPath(files[ i ].path);
+		order[ i ] = i;
+	}
+	std::sort(order.begin(), order.end(), [&archiveEntries](uint32_t a, uint32_t b)
+		{ return archiveEntries[ a ].pathHash < archiveEntries[ b ].pathHash; });
+
+	for(uint32_t i = 1; i < uint32_t(order.size()); ++i)
+	{
+		if(archiveEntries[ order[ i ] ].pathHash == archiveEntries[ order[ i - 1 ] ].pathHash)
+		{
+			printf("Asset paths collide: %s, %s\n", files[ order[ i - 1 ] ].path.c_str(), files[ order[ i ] ].path.c_str());
+			return false;
+		}
+	}
+
+	std::vector<MappedFile> sources(files.size());
+	uint64_t offset = sizeof(AssetArchiveHeader) + files.size() * sizeof(AssetArchiveEntry);
+	for(uint32_t i = 0; i < uint32_t(order.size()); ++i)
+	{
+		AssetArchiveEntry &entry = archiveEntries[ order[ i ] ];
+		entry.pathOffset = uint32_t(offset);
+		entry.pathLength = uint32_t(files[ order[ i ] ].path.length());
+		offset += entry.pathLength;
+	}
+	for(uint32_t i = 0; i < uint32_t(order.size()); ++i)
+	{
+		const AssetArchiveInput &input = files[ order[ i ] ];
+		if(!sources[ i ].open(input.sourceFileName))
+		{
+			printf("Failed to open asset: %s\n", input.sourceFileName.c_str());
+			return false;
+		}
+		offset = (offset + AssetDataAlignment - 1u) & ~(AssetDataAlignment - 1u);
+
+		AssetArchiveEntry &entry = archiveEntries[ order[ i ] ];
+		entry.dataOffset = offset;
+		entry.dataSize = sources[ i ].size;
+		offset += entry.dataSize;
+	}
+
+	AssetArchiveHeader header{ .magic = AssetArchiveMagic, .version = AssetArchiveVersion,
+		.entryCount = uint32_t(files.size()), .padding = 0u, .fileSize = offset };
+
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if(!file)
+	{
+		printf("Failed to create asset archive: %s\n", fileName.c_str());
+		return false;
+	}
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+	for(uint32_t i = 0; i < uint32_t(order.size()) && success; ++i)
+		success = fwrite(&archiveEntries[ order[ i ] ], sizeof(AssetArchiveEntry), 1, file) == 1;
+	for(uint32_t i = 0; i < uint32_t(order.size()) && success; ++i)
+	{
+		const std::string &path = files[ order[ i ] ].path;
+		success = fwrite(path.data(), 1, path.length(), file) == path.length();
+	}
+
+	uint64_t written = archiveEntries.empty() ? offset
+		: archiveEntries[ order.back() ].pathOffset + archiveEntries[ order.back() ].pathLength;
+	for(uint32_t i = 0; i < uint32_t(order.size()) && success; ++i)
+	{
+		const AssetArchiveEntry &entry = archiveEntries[ order[ i ] ];
+		success = writeZeros(file, entry.dataOffset - written) &&
+			fwrite(sources[ i ].data, 1, size_t(entry.dataSize), file) == size_t(entry.dataSize);
+		written = entry.dataOffset + entry.dataSize;
+	}
+	fclose(file);
+
+	if(!success)
+	{
+		printf("Failed to write asset archive: %s\n", fileName.c_str());
+		return false;
+	}
+	printf("Wrote %u assets, %llu bytes into: %s\n", header.entryCount, (unsigned long long)header.fileSize,
+		fileName.c_str());
+	return true;
+}
+
+bool Vfs::mountArchive(const std::string &fileName)
+{
+	unmount();
+	if(!archive.open(fileName))
+		return false;
+
+	const AssetArchiveHeader *header = (const AssetArchiveHeader *)archive.data;
+	if(archive.size < sizeof(AssetArchiveHeader) || header->magic != AssetArchiveMagic ||
+		header->version != AssetArchiveVersion || header->fileSize != archive.size ||
+		sizeof(AssetArchiveHeader) + uint64_t(header->entryCount) * sizeof(AssetArchiveEntry) > archive.size)
+	{
+		printf("Invalid asset archive: %s\n", fileName.c_str());
+		archive.close();
+		return false;
+	}
+
+	entries = std::span<const AssetArchiveEntry>(
+		(const AssetArchiveEntry *)(archive.data + sizeof(AssetArchiveHeader)), header->entryCount);
+	for(const AssetArchiveEntry &entry : entries)
+	{
+		if(uint64_t(entry.pathOffset) + entry.pathLength > archive.size || entry.dataOffset + entry.dataSize > archive.size)
+		{
+			printf("Invalid asset archive: %s\n", fileName.c_str());
+			unmount();
+			return false;
+		}
+	}
+	printf("Mounted asset archive: %s, %u files\n", fileName.c_str(), header->entryCount);
+	return true;
+}
+
+void Vfs::unmount()
+{
+	std::lock_guard<std::mutex> lock(looseMutex);
+	entries = {};
+	archive.close();
+	looseFiles.clear();
+	looseFileCount = 0u;
+}
+
+const AssetArchiveEntry *Vfs::findEntry(std::string_view path) const
+{
+	uint64_t hash = hashAssetPath(path);
+	auto iter = std::lower_bound(entries.begin(), entries.end(), hash,
+		[](const AssetArchiveEntry &entry, uint64_t value) { return entry.pathHash < value; });
+	if(iter == entries.end() || iter->pathHash != hash)
+		return nullptr;
+
+	// Hash only picks the entry, the path still has to match.
+	std::string_view entryPath((const char *)archive.data + iter->pathOffset, iter->pathLength);
+	if(entryPath.length() != path.length())
+		return nullptr;
+	for(size_t i = 0; i < path.length(); ++i)
+	{
+		char c = path[ i ] == '\\' ? '/' : path[ i ];
+		if(entryPath[ i ] != c)
+			return nullptr;
+	}
+	return &(*iter);
+}
+
+std::span<const uint8_t> Vfs::getFile(std::string_view path)
+{
+	if(const AssetArchiveEntry *entry = findEntry(path))
+		return std::span<const uint8_t>(archive.data + entry->dataOffset, size_t(entry->dataSize));
+
+	std::lock_guard<std::mutex> lock(looseMutex);
+	std::string fileName(path);
+	auto iter = looseFiles.find(fileName);
+	if(iter == looseFiles.end())
+	{
+		std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>();
+		if(!file->open(fileName))
+			return {};
+
+		++looseFileCount;
+		iter = looseFiles.emplace(std::move(fileName), std::move(file)).first;
+	}
+	return std::span<const uint8_t>(iter->second->data, iter->second->size);
+}
+
+std::string_view Vfs::getText(std::string_view path)
+{
+	std::span<const uint8_t> file = getFile(path);
+	return std::string_view((const char *)file.data(), file.size());
+}
+
+Vfs &getVfs()
+{
+	static Vfs vfs;
+	return vfs;
+}
+
+}; // end of core namespace.
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mappedfile.h"
+
+namespace core
+{
+
+// Asset archive:
+//   AssetArchiveHeader
+//   AssetArchiveEntry[ entryCount ], sorted by pathHash
+//   path strings, not null terminated
+//   file data, every file 16 byte aligned
+// Paths are relative to the working directory the apps run from, with '/' separators, like
+// "assets/shaders/model.vert".
+static constexpr uint32_t AssetArchiveMagic = 0x4B415048u; // "HPAK"
+static constexpr uint32_t AssetArchiveVersion = 1u;
+
+struct AssetArchiveHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t padding;
+	uint64_t fileSize;
+};
+
+struct AssetArchiveEntry
+{
+	uint64_t pathHash;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+	uint32_t pathOffset;
+	uint32_t pathLength;
+};
+
+struct AssetArchiveInput
+{
+	std::string path;
+	std::string sourceFileName;
+};
+
+uint64_t hashAssetPath(std::string_view path);
+// Writes files into archive, fails on duplicate paths or hash collisions.
+bool writeAssetArchive(const std::string &fileName, const std::vector<AssetArchiveInput> &files);
+
+// Read only view to assets. Files come straight from the memory mapped archive, files missing from it
+// fall back to loose files on disk, which get mapped once and kept until unmount.
+class Vfs
+{
+public:
+	bool mountArchive(const std::string &fileName);
+	void unmount();
+	bool hasArchive() const { return archive.isOpen(); }
+
+	// Empty span if file does not exist. Views stay valid until unmount. Thread safe.
+	std::span<const uint8_t> getFile(std::string_view path);
+	std::string_view getText(std::string_view path);
+
+	// How many files were served from disk instead of the archive.
+	uint32_t looseFileCount = 0u;
+
+private:
+	const AssetArchiveEntry *findEntry(std::string_view path) const;
+
+	MappedFile archive;
+	std::span<const AssetArchiveEntry> entries;
+
+	std::mutex looseMutex;
+	std::unordered_map<std::string, std::unique_ptr<MappedFile>> looseFiles;
+};
+
+// Shared instance every app and library uses for assets.
+Vfs &getVfs();
+
+}; // end of core namespace.
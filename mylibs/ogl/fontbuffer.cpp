@@ -0,0 +1,30 @@
+#include "fontbuffer.h"
+
+#include "../../external/glad/glad.h"
+
+#include <cstring>
+#include <vector>
+
+FontBuffer::FontBuffer(const uint8_t *glyphData, uint32_t glyphDataSize) :
+	buffer(GL_SHADER_STORAGE_BUFFER, GlyphCount * GlyphBytes, GL_DYNAMIC_STORAGE_BIT, nullptr, true)
+{
+	if(glyphDataSize >= buffer.size)
+	{
+		buffer.updateBuffer(0u, buffer.size, (void *)glyphData);
+		return;
+	}
+
+	// Shorter fonts leave the missing glyphs empty.
+	std::vector<uint8_t> bytes(buffer.size, 0u);
+	memcpy(bytes.data(), glyphData, glyphDataSize);
+	buffer.updateBuffer(0u, buffer.size, bytes.data());
+}
+
+void FontBuffer::updateGlyph(uint32_t letter, const uint8_t *glyphData)
+{
+	if(letter < 32u || letter >= 32u + GlyphCount)
+		return;
+
+	uint32_t offset = (letter - 32u) * GlyphBytes;
+	buffer.updateBuffer(offset, GlyphBytes, (void *)glyphData);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "shaderbuffer.h"
+
+// Raw 8x12 bitmap font bytes as ssbo, 12 bytes per glyph, one byte per row, bit x is column x. Fragment
+// shader tests the bit directly, so no atlas texture gets built.
+class FontBuffer
+{
+public:
+	static constexpr uint32_t GlyphBytes = 12u;
+	static constexpr uint32_t GlyphCount = 128u - 32u;
+
+	// glyphData is glyph data of 8x12 font size starting from ' ', as core::FontFile::getGlyphData gives.
+	FontBuffer(const uint8_t *glyphData, uint32_t glyphDataSize);
+
+	// Uploads the 12 bytes of one glyph, letter is ascii code. glyphData points to that glyph only, as
+	// core::FontFile::getGlyph gives.
+	void updateGlyph(uint32_t letter, const uint8_t *glyphData);
+	void bind(uint32_t slot) { buffer.bind(slot); }
+	void unbind() { buffer.unbind(); }
+
+	ShaderBuffer buffer;
+};
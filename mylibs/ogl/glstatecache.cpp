@@ -0,0 +1,145 @@
+#include "glstatecache.h"
+
+#include "../../external/glad/glad.h"
+
+#include <cassert>
+
+void GlStateCache::invalidate()
+{
+	program = ~0u;
+	vao = ~0u;
+	elementBuffer = ~0u;
+	drawIndirectBuffer = ~0u;
+	blend = ~0u;
+	viewportWidth = ~0u;
+	viewportHeight = ~0u;
+	for(StorageBinding &binding : storageBindings)
+		binding = StorageBinding{ ~0u, ~0u, ~0u };
+	for(uint32_t &texture : textures)
+		texture = ~0u;
+}
+
+void GlStateCache::useProgram(uint32_t newProgram)
+{
+	if(program == newProgram)
+	{
+		++skippedCalls;
+		return;
+	}
+	program = newProgram;
+	glUseProgram(newProgram);
+	++issuedCalls;
+}
+
+void GlStateCache::bindVertexArray(uint32_t newVao)
+{
+	if(vao == newVao)
+	{
+		++skippedCalls;
+		return;
+	}
+	vao = newVao;
+	elementBuffer = ~0u;
+	glBindVertexArray(newVao);
+	++issuedCalls;
+}
+
+void GlStateCache::bindElementBuffer(uint32_t buffer)
+{
+	if(elementBuffer == buffer)
+	{
+		++skippedCalls;
+		return;
+	}
+	elementBuffer = buffer;
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+	++issuedCalls;
+}
+
+void GlStateCache::bindDrawIndirectBuffer(uint32_t buffer)
+{
+	if(drawIndirectBuffer == buffer)
+	{
+		++skippedCalls;
+		return;
+	}
+	drawIndirectBuffer = buffer;
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+	++issuedCalls;
+}
+
+void GlStateCache::bindStorageBuffer(uint32_t slot, uint32_t buffer, uint32_t offset, uint32_t size)
+{
+	assert(slot < MaxStorageSlots && "Storage slot out of range");
+	StorageBinding &binding = storageBindings[ slot ];
+	if(binding.buffer == buffer && binding.offset == offset && binding.size == size)
+	{
+		++skippedCalls;
+		return;
+	}
+	binding = StorageBinding{ buffer, offset, size };
+	if(size > 0u)
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, slot, buffer, offset, size);
+	else
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, slot, buffer);
+	++issuedCalls;
+}
+
+void GlStateCache::bindTexture(uint32_t unit, uint32_t texture)
+{
+	assert(unit < MaxTextureUnits && "Texture unit out of range");
+	if(textures[ unit ] == texture)
+	{
+		++skippedCalls;
+		return;
+	}
+	textures[ unit ] = texture;
+	glBindTextureUnit(unit, texture);
+	++issuedCalls;
+}
+
+void GlStateCache::setBlend(uint32_t newBlend)
+{
+	if(blend == newBlend)
+	{
+		++skippedCalls;
+		return;
+	}
+
+	// Blending stays enabled between alpha and additive, only the function changes.
+	if(newBlend == BlendOpaque)
+	{
+		glDisable(GL_BLEND);
+		++issuedCalls;
+	}
+	else
+	{
+		if(blend == ~0u || blend == BlendOpaque)
+		{
+			glEnable(GL_BLEND);
+			++issuedCalls;
+		}
+		glBlendFunc(GL_SRC_ALPHA, newBlend == BlendAdditive ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA);
+		++issuedCalls;
+	}
+	blend = newBlend;
+}
+
+void GlStateCache::setViewport(uint32_t width, uint32_t height)
+{
+	if(viewportWidth == width && viewportHeight == height)
+	{
+		++skippedCalls;
+		return;
+	}
+	viewportWidth = width;
+	viewportHeight = height;
+	glViewport(0, 0, GLsizei(width), GLsizei(height));
+	++issuedCalls;
+}
+
+void GlStateCache::resetStats()
+{
+	issuedCalls = 0u;
+	skippedCalls = 0u;
+}
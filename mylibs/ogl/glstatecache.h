@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+// Last state given to GL, setting the same state again is skipped. GL state changed outside of the cache
+// has to be followed by invalidate, otherwise the cache skips calls it should not.
+class GlStateCache
+{
+public:
+	static constexpr uint32_t BlendOpaque = 0u;
+	static constexpr uint32_t BlendAlpha = 1u;
+	static constexpr uint32_t BlendAdditive = 2u;
+
+	static constexpr uint32_t MaxStorageSlots = 16u;
+	static constexpr uint32_t MaxTextureUnits = 16u;
+
+	GlStateCache() { invalidate(); }
+
+	void invalidate();
+
+	void useProgram(uint32_t program);
+	void bindVertexArray(uint32_t vao);
+	// Element buffer is vertex array state, changing vertex array forgets it.
+	void bindElementBuffer(uint32_t buffer);
+	void bindDrawIndirectBuffer(uint32_t buffer);
+	// size 0 binds the whole buffer.
+	void bindStorageBuffer(uint32_t slot, uint32_t buffer, uint32_t offset, uint32_t size);
+	void bindTexture(uint32_t unit, uint32_t texture);
+	void setBlend(uint32_t blend);
+	void setViewport(uint32_t width, uint32_t height);
+
+	void resetStats();
+
+	// GL calls made through the cache, including draws and uniforms, and state calls it skipped.
+	uint32_t issuedCalls = 0u;
+	uint32_t skippedCalls = 0u;
+
+private:
+	struct StorageBinding
+	{
+		uint32_t buffer;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	uint32_t program = ~0u;
+	uint32_t vao = ~0u;
+	uint32_t elementBuffer = ~0u;
+	uint32_t drawIndirectBuffer = ~0u;
+	uint32_t blend = ~0u;
+	uint32_t viewportWidth = ~0u;
+	uint32_t viewportHeight = ~0u;
+	StorageBinding storageBindings[ MaxStorageSlots ];
+	uint32_t textures[ MaxTextureUnits ];
+};
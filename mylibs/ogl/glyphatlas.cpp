@@ -0,0 +1,235 @@
+#include "glyphatlas.h"
+
+#include "../../external/glad/glad.h"
+#include "../core/fontfile.h"
+
+#include <cassert>
+#include <cstdio>
+
+// Code points take 21 bits, the size index goes above them.
+static uint32_t getGlyphKey(uint32_t sizeIndex, uint32_t codePoint)
+{
+	return (sizeIndex << 21u) | codePoint;
+}
+
+GlyphAtlas::GlyphAtlas(const core::FontFile &font, uint32_t width, uint32_t height, uint32_t maxGlyphs,
+	const core::SdfBakeParams &params) :
+	// Ssbo size has to be multiple of 16 bytes.
+	rectBuffer(GL_SHADER_STORAGE_BUFFER, (maxGlyphs * 8u + 15u) & ~15u, GL_DYNAMIC_STORAGE_BIT, nullptr, true),
+	font(font)
+{
+	assert(maxGlyphs > 0u && maxGlyphs < InvalidSlot && "Glyph atlas slots have to fit in 16 bits");
+	assert(width <= 65535u && height <= 65535u && "Glyph atlas cell positions have to fit in 16 bits");
+
+	this->width = width;
+	this->height = height;
+	this->maxGlyphs = maxGlyphs;
+	this->params = params;
+	glyphs.reserve(maxGlyphs);
+	slotMap.reserve(maxGlyphs);
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, 1, GL_R8, GLsizei(width), GLsizei(height));
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+	if(texture)
+		glDeleteTextures(1, &texture);
+	texture = 0u;
+}
+
+uint32_t GlyphAtlas::acquire(uint32_t sizeIndex, uint32_t codePoint)
+{
+	const core::FontSizeInfo &sizeInfo = font.getSize(sizeIndex);
+	if(codePoint < sizeInfo.firstChar || codePoint > sizeInfo.lastChar)
+		codePoint = uint32_t('?') >= sizeInfo.firstChar && uint32_t('?') <= sizeInfo.lastChar ? uint32_t('?')
+			: sizeInfo.firstChar;
+
+	uint32_t key = getGlyphKey(sizeIndex, codePoint);
+	auto iter = slotMap.find(key);
+	if(iter != slotMap.end())
+	{
+		Glyph &glyph = glyphs[ iter->second ];
+		if(glyph.refCount == 0u)
+			unlinkLru(iter->second);
+		++glyph.refCount;
+		++hitCount;
+		return iter->second;
+	}
+
+	uint32_t cellWidth = sizeInfo.glyphWidth * params.texelsPerPixel + params.padding * 2u;
+	uint32_t cellHeight = sizeInfo.glyphHeight * params.texelsPerPixel + params.padding * 2u;
+	uint32_t slot = allocateSlot(cellWidth, cellHeight);
+	if(slot == InvalidSlot)
+	{
+		printf("Glyph atlas is full, cannot add glyph %u\n", codePoint);
+		return InvalidSlot;
+	}
+	++missCount;
+
+	Glyph &glyph = glyphs[ slot ];
+	glyph.key = key;
+	glyph.refCount = 1u;
+	slotMap.emplace(key, slot);
+
+	// Bake only the new cell and upload it, evicted glyphs just get overwritten.
+	bakeTexels.resize(size_t(cellWidth) * cellHeight);
+	const uint8_t *glyphData = font.getGlyphData(sizeIndex) + (codePoint - sizeInfo.firstChar) * sizeInfo.bytesPerGlyph;
+	core::bakeSdfGlyph(glyphData, sizeInfo, params, bakeTexels.data(), cellWidth);
+	uploadGlyph(slot, cellWidth, cellHeight, bakeTexels.data(), cellWidth);
+	return slot;
+}
+
+bool GlyphAtlas::addBakedGlyphs(uint32_t sizeIndex, const core::SdfAtlas &bakedAtlas)
+{
+	const core::FontSizeInfo &sizeInfo = font.getSize(sizeIndex);
+	uint32_t cellWidth = sizeInfo.glyphWidth * params.texelsPerPixel + params.padding * 2u;
+	uint32_t cellHeight = sizeInfo.glyphHeight * params.texelsPerPixel + params.padding * 2u;
+	if(bakedAtlas.texelsPerPixel != params.texelsPerPixel || bakedAtlas.padding != params.padding ||
+		bakedAtlas.cellWidth != cellWidth || bakedAtlas.cellHeight != cellHeight ||
+		bakedAtlas.glyphCount != uint32_t(sizeInfo.lastChar - sizeInfo.firstChar) + 1u)
+	{
+		printf("Baked sdf atlas does not match glyph atlas params\n");
+		return false;
+	}
+
+	for(uint32_t i = 0; i < bakedAtlas.glyphCount; ++i)
+	{
+		uint32_t key = getGlyphKey(sizeIndex, sizeInfo.firstChar + i);
+		if(slotMap.find(key) != slotMap.end())
+			continue;
+
+		// Only free cells, evicting would throw out glyphs added just before.
+		uint32_t cellX = 0u;
+		uint32_t cellY = 0u;
+		if(uint32_t(glyphs.size()) >= maxGlyphs || !allocateCell(cellWidth, cellHeight, cellX, cellY))
+			break;
+
+		uint32_t slot = uint32_t(glyphs.size());
+		glyphs.emplace_back(Glyph{ .key = key, .refCount = 0u, .cellX = uint16_t(cellX), .cellY = uint16_t(cellY),
+			.cellWidth = uint16_t(cellWidth), .cellHeight = uint16_t(cellHeight), .prev = InvalidSlot,
+			.next = InvalidSlot });
+		slotMap.emplace(key, slot);
+		pushLru(slot);
+
+		uint32_t column = i % bakedAtlas.columns;
+		uint32_t row = i / bakedAtlas.columns;
+		const uint8_t *cellTexels = bakedAtlas.texels.data() + (size_t(row) * cellHeight * bakedAtlas.width) +
+			size_t(column) * cellWidth;
+		uploadGlyph(slot, cellWidth, cellHeight, cellTexels, bakedAtlas.width);
+	}
+	return true;
+}
+
+void GlyphAtlas::release(uint32_t slot)
+{
+	if(slot == InvalidSlot)
+		return;
+
+	Glyph &glyph = glyphs[ slot ];
+	assert(glyph.refCount > 0u && "Releasing glyph without references");
+	if(--glyph.refCount == 0u)
+		pushLru(slot);
+}
+
+uint32_t GlyphAtlas::allocateSlot(uint32_t cellWidth, uint32_t cellHeight)
+{
+	uint32_t cellX = 0u;
+	uint32_t cellY = 0u;
+	if(uint32_t(glyphs.size()) < maxGlyphs && allocateCell(cellWidth, cellHeight, cellX, cellY))
+	{
+		glyphs.emplace_back(Glyph{ .key = 0u, .refCount = 0u, .cellX = uint16_t(cellX), .cellY = uint16_t(cellY),
+			.cellWidth = uint16_t(cellWidth), .cellHeight = uint16_t(cellHeight), .prev = InvalidSlot,
+			.next = InvalidSlot });
+		return uint32_t(glyphs.size() - 1u);
+	}
+
+	// Evict the least recently released glyph whose cell is big enough.
+	for(uint32_t slot = lruHead; slot != InvalidSlot; slot = glyphs[ slot ].next)
+	{
+		Glyph &glyph = glyphs[ slot ];
+		if(glyph.cellWidth < cellWidth || glyph.cellHeight < cellHeight)
+			continue;
+
+		unlinkLru(slot);
+		slotMap.erase(glyph.key);
+		++evictCount;
+		return slot;
+	}
+	return InvalidSlot;
+}
+
+bool GlyphAtlas::allocateCell(uint32_t cellWidth, uint32_t cellHeight, uint32_t &cellXOut, uint32_t &cellYOut)
+{
+	// Lowest shelf that fits without wasting more than a quarter of its height.
+	Shelf *best = nullptr;
+	for(Shelf &shelf : shelves)
+	{
+		if(shelf.height < cellHeight || shelf.height > cellHeight + cellHeight / 4u || shelf.nextX + cellWidth > width)
+			continue;
+		if(!best || shelf.height < best->height)
+			best = &shelf;
+	}
+
+	if(!best)
+	{
+		if(shelfBottom + cellHeight > height || cellWidth > width)
+			return false;
+		shelves.emplace_back(Shelf{ .y = shelfBottom, .height = cellHeight, .nextX = 0u });
+		shelfBottom += cellHeight;
+		best = &shelves.back();
+	}
+
+	cellXOut = best->nextX;
+	cellYOut = best->y;
+	best->nextX += cellWidth;
+	return true;
+}
+
+void GlyphAtlas::uploadGlyph(uint32_t slot, uint32_t cellWidth, uint32_t cellHeight, const uint8_t *texels,
+	uint32_t rowTexels)
+{
+	const Glyph &glyph = glyphs[ slot ];
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, GLint(rowTexels));
+	glTextureSubImage2D(texture, 0, GLint(glyph.cellX), GLint(glyph.cellY), GLsizei(cellWidth), GLsizei(cellHeight),
+		GL_RED, GL_UNSIGNED_BYTE, texels);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	uint32_t rect[2] = {
+		(glyph.cellX + params.padding) | ((glyph.cellY + params.padding) << 16u),
+		(cellWidth - params.padding * 2u) | ((cellHeight - params.padding * 2u) << 16u) };
+	rectBuffer.updateBuffer(slot * 8u, 8u, rect);
+}
+
+void GlyphAtlas::unlinkLru(uint32_t slot)
+{
+	Glyph &glyph = glyphs[ slot ];
+	if(glyph.prev != InvalidSlot)
+		glyphs[ glyph.prev ].next = glyph.next;
+	else
+		lruHead = glyph.next;
+	if(glyph.next != InvalidSlot)
+		glyphs[ glyph.next ].prev = glyph.prev;
+	else
+		lruTail = glyph.prev;
+	glyph.prev = InvalidSlot;
+	glyph.next = InvalidSlot;
+}
+
+void GlyphAtlas::pushLru(uint32_t slot)
+{
+	Glyph &glyph = glyphs[ slot ];
+	glyph.prev = lruTail;
+	glyph.next = InvalidSlot;
+	if(lruTail != InvalidSlot)
+		glyphs[ lruTail ].next = slot;
+	else
+		lruHead = slot;
+	lruTail = slot;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/sdfbaker.h"
+#include "shaderbuffer.h"
+
+namespace core
+{
+class FontFile;
+};
+
+// Distance field glyphs baked on demand into one R8 texture, so text can use any code point the font has
+// without baking every glyph up front. Glyphs are packed on shelves of similar height. Glyphs nobody
+// references stay cached in lru order, and when the texture or slots run out the least recently released
+// one gets evicted and its cell reused. Each miss uploads only the new cell.
+class GlyphAtlas
+{
+public:
+	static constexpr uint32_t InvalidSlot = 0xFFFFu;
+
+	// maxGlyphs has to be less than InvalidSlot, slots go to the gpu as 16 bit indices.
+	GlyphAtlas(const core::FontFile &font, uint32_t width, uint32_t height, uint32_t maxGlyphs,
+		const core::SdfBakeParams &params = core::SdfBakeParams{});
+	~GlyphAtlas();
+	GlyphAtlas(const GlyphAtlas &) = delete;
+	GlyphAtlas &operator=(const GlyphAtlas &) = delete;
+
+	// Returns slot of the glyph and adds reference to it, missing glyph gets baked and uploaded. Code points
+	// the font size does not have use '?'. Returns InvalidSlot if every cell that fits is referenced.
+	uint32_t acquire(uint32_t sizeIndex, uint32_t codePoint);
+	// Glyph stays in the atlas until it gets evicted, acquiring it again is a hit.
+	void release(uint32_t slot);
+	// Copies glyphs of a size baked up front, for example by loadOrBakeSdfAtlas, into free cells so they
+	// are hits from the start. They go in without references, evictable like released glyphs. Stops when
+	// the atlas is full, and returns false if the bake params differ from the ones of this atlas.
+	bool addBakedGlyphs(uint32_t sizeIndex, const core::SdfAtlas &bakedAtlas);
+
+	uint32_t getGlyphCount() const { return uint32_t(glyphs.size()); }
+
+	uint32_t texture = 0u;
+	// Glyph rect per slot as uvec2, x is texel position of the glyph inside its padding, 16 bits for x and y,
+	// y is size in texels, 16 bits for width and height.
+	ShaderBuffer rectBuffer;
+	uint32_t width = 0u;
+	uint32_t height = 0u;
+
+	uint32_t hitCount = 0u;
+	uint32_t missCount = 0u;
+	uint32_t evictCount = 0u;
+
+private:
+	struct Shelf
+	{
+		uint32_t y;
+		uint32_t height;
+		uint32_t nextX;
+	};
+
+	struct Glyph
+	{
+		uint32_t key;
+		uint32_t refCount;
+		uint16_t cellX;
+		uint16_t cellY;
+		uint16_t cellWidth;
+		uint16_t cellHeight;
+		// Lru links, only for glyphs without references.
+		uint32_t prev;
+		uint32_t next;
+	};
+
+	uint32_t allocateSlot(uint32_t cellWidth, uint32_t cellHeight);
+	bool allocateCell(uint32_t cellWidth, uint32_t cellHeight, uint32_t &cellXOut, uint32_t &cellYOut);
+	// Uploads cell texels and rect of the slot, cell can be smaller than the slot when it was evicted from a
+	// bigger glyph. rowTexels is the row pitch of texels.
+	void uploadGlyph(uint32_t slot, uint32_t cellWidth, uint32_t cellHeight, const uint8_t *texels,
+		uint32_t rowTexels);
+	void unlinkLru(uint32_t slot);
+	void pushLru(uint32_t slot);
+
+	const core::FontFile &font;
+	core::SdfBakeParams params;
+	uint32_t maxGlyphs = 0u;
+
+	std::vector<Glyph> glyphs;
+	std::vector<Shelf> shelves;
+	std::unordered_map<uint32_t, uint32_t> slotMap;
+	std::vector<uint8_t> bakeTexels;
+	uint32_t shelfBottom = 0u;
+	uint32_t lruHead = InvalidSlot;
+	uint32_t lruTail = InvalidSlot;
+};
@@ -0,0 +1,202 @@
+#include "gputimerpool.h"
+
+#include "../../external/glad/glad.h"
+
+#include <cassert>
+
+GpuTimerPool::GpuTimerPool(uint32_t maxScopes, uint32_t framesInFlight, bool useQueryBuffer)
+{
+	assert(maxScopes > 0u && "Timer pool needs at least one scope");
+	assert(framesInFlight > 1u && "Timer pool needs at least 2 frames in flight to avoid stalls");
+
+	this->maxScopes = maxScopes;
+	this->framesInFlight = framesInFlight;
+	this->useQueryBuffer = useQueryBuffer;
+
+	scopeNames.reserve(maxScopes);
+	scopeTimes.reserve(maxScopes);
+
+	queries.resize(size_t(maxScopes) * 2u * framesInFlight);
+	glCreateQueries(GL_TIMESTAMP, GLsizei(queries.size()), queries.data());
+
+	frames.resize(framesInFlight);
+	for(FrameQueries &frame : frames)
+		frame.written.resize(size_t(maxScopes) * 2u);
+
+	if(useQueryBuffer)
+	{
+		GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr bufferSize = GLsizeiptr(queries.size() * sizeof(uint64_t));
+
+		glCreateBuffers(1, &queryBuffer);
+		assert(queryBuffer && "Failed to generate query buffer handle!");
+		glNamedBufferStorage(queryBuffer, bufferSize, nullptr, flags);
+		queryBufferMapped = (const uint64_t *)glMapNamedBufferRange(queryBuffer, 0, bufferSize, flags);
+		assert(queryBufferMapped && "Failed to map query buffer!");
+	}
+}
+
+GpuTimerPool::~GpuTimerPool()
+{
+	for(FrameQueries &frame : frames)
+	{
+		if(frame.fence)
+			glDeleteSync(GLsync(frame.fence));
+		frame.fence = nullptr;
+	}
+
+	if(queryBuffer)
+	{
+		glUnmapNamedBuffer(queryBuffer);
+		glDeleteBuffers(1, &queryBuffer);
+	}
+	queryBuffer = 0u;
+	queryBufferMapped = nullptr;
+
+	glDeleteQueries(GLsizei(queries.size()), queries.data());
+	queries.clear();
+}
+
+uint32_t GpuTimerPool::addScope(const char *name)
+{
+	assert(scopeNames.size() < maxScopes && "Too many scopes for timer pool");
+	scopeNames.push_back(name);
+	scopeTimes.push_back(0.0f);
+	return uint32_t(scopeNames.size() - 1u);
+}
+
+uint32_t GpuTimerPool::getQueryIndex(uint32_t frameSlot, uint32_t scope, uint32_t endQuery) const
+{
+	return (frameSlot * maxScopes + scope) * 2u + endQuery;
+}
+
+void GpuTimerPool::beginFrame()
+{
+	FrameQueries &frame = frames[currentSlot];
+	if(frame.pending && !tryResolve(currentSlot))
+	{
+		// Gpu is more than framesInFlight behind, drop the results instead of waiting.
+		++droppedFrames;
+		if(frame.fence)
+			glDeleteSync(GLsync(frame.fence));
+		frame.fence = nullptr;
+		frame.pending = false;
+	}
+
+	for(uint8_t &w : frame.written)
+		w = 0u;
+	frame.lastQuery = ~0u;
+}
+
+void GpuTimerPool::beginScope(uint32_t scope)
+{
+	assert(scope < scopeNames.size() && "Unknown timer scope");
+	uint32_t index = getQueryIndex(currentSlot, scope, 0u);
+	glQueryCounter(queries[index], GL_TIMESTAMP);
+	frames[currentSlot].written[size_t(scope) * 2u + 0u] = 1u;
+	frames[currentSlot].lastQuery = index;
+}
+
+void GpuTimerPool::endScope(uint32_t scope)
+{
+	assert(scope < scopeNames.size() && "Unknown timer scope");
+	uint32_t index = getQueryIndex(currentSlot, scope, 1u);
+	glQueryCounter(queries[index], GL_TIMESTAMP);
+	frames[currentSlot].written[size_t(scope) * 2u + 1u] = 1u;
+	frames[currentSlot].lastQuery = index;
+}
+
+void GpuTimerPool::endFrame()
+{
+	FrameQueries &frame = frames[currentSlot];
+	frame.pending = true;
+
+	if(useQueryBuffer)
+	{
+		// The results are written by the gpu into the buffer once they are ready, the cpu only
+		// checks the fence later on.
+		for(uint32_t i = 0; i < uint32_t(frame.written.size()); ++i)
+		{
+			if(!frame.written[i])
+				continue;
+			uint32_t index = getQueryIndex(currentSlot, 0u, 0u) + i;
+			glGetQueryBufferObjectui64v(queries[index], queryBuffer, GL_QUERY_RESULT,
+				GLintptr(index * sizeof(uint64_t)));
+		}
+		frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Resolve older frames that are already done.
+	for(uint32_t i = 1; i < framesInFlight; ++i)
+	{
+		uint32_t slot = (currentSlot + framesInFlight - i) % framesInFlight;
+		if(frames[slot].pending)
+			tryResolve(slot);
+	}
+
+	currentSlot = (currentSlot + 1u) % framesInFlight;
+}
+
+bool GpuTimerPool::tryResolve(uint32_t frameSlot)
+{
+	FrameQueries &frame = frames[frameSlot];
+	assert(frame.pending);
+
+	if(useQueryBuffer)
+	{
+		GLenum result = glClientWaitSync(GLsync(frame.fence), 0, 0);
+		if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+			return false;
+		glDeleteSync(GLsync(frame.fence));
+		frame.fence = nullptr;
+	}
+	else
+	{
+		// Timestamps finish in order, so if the last issued one is available all of them are.
+		if(frame.lastQuery != ~0u)
+		{
+			int available = 0;
+			glGetQueryObjectiv(queries[frame.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+			if(!available)
+				return false;
+		}
+	}
+
+	for(uint32_t scope = 0; scope < uint32_t(scopeNames.size()); ++scope)
+	{
+		if(!frame.written[size_t(scope) * 2u + 0u] || !frame.written[size_t(scope) * 2u + 1u])
+			continue;
+
+		uint32_t startIndex = getQueryIndex(frameSlot, scope, 0u);
+		uint32_t endIndex = getQueryIndex(frameSlot, scope, 1u);
+		GLuint64 startTime = 0;
+		GLuint64 endTime = 0;
+
+		if(useQueryBuffer)
+		{
+			startTime = queryBufferMapped[startIndex];
+			endTime = queryBufferMapped[endIndex];
+		}
+		else
+		{
+			glGetQueryObjectui64v(queries[startIndex], GL_QUERY_RESULT, &startTime);
+			glGetQueryObjectui64v(queries[endIndex], GL_QUERY_RESULT, &endTime);
+		}
+		scopeTimes[scope] = float(double(endTime - startTime) / 1000000.0);
+	}
+
+	frame.pending = false;
+	return true;
+}
+
+float GpuTimerPool::getScopeTime(uint32_t scope) const
+{
+	assert(scope < scopeTimes.size() && "Unknown timer scope");
+	return scopeTimes[scope];
+}
+
+const char *GpuTimerPool::getScopeName(uint32_t scope) const
+{
+	assert(scope < scopeNames.size() && "Unknown timer scope");
+	return scopeNames[scope];
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Timestamp queries for named scopes, with a ring of query sets sized to frames in flight.
+// Results are only read once the gpu has them available, so timing never adds a sync point.
+// The results lag behind by framesInFlight - 1 frames.
+class GpuTimerPool
+{
+public:
+	// useQueryBuffer writes the results through GL_QUERY_BUFFER into persistently mapped buffer
+	// guarded by fence, instead of polling GL_QUERY_RESULT_AVAILABLE.
+	GpuTimerPool(uint32_t maxScopes, uint32_t framesInFlight = 3u, bool useQueryBuffer = false);
+	~GpuTimerPool();
+
+	// Returns scope index used with beginScope / endScope / getScopeTime.
+	uint32_t addScope(const char *name);
+
+	void beginFrame();
+	void beginScope(uint32_t scope);
+	void endScope(uint32_t scope);
+	void endFrame();
+
+	// Last resolved time in milliseconds.
+	float getScopeTime(uint32_t scope) const;
+	const char *getScopeName(uint32_t scope) const;
+	uint32_t getScopeCount() const { return uint32_t(scopeNames.size()); }
+
+	// Frames that had to be reused before their results were available.
+	uint32_t droppedFrames = 0u;
+
+private:
+	struct FrameQueries
+	{
+		// bit per begin/end query that was written this frame.
+		std::vector<uint8_t> written;
+		// Query index of the last timestamp issued this frame, ~0u if none. Scopes can end in any order,
+		// so it is not the highest written index.
+		uint32_t lastQuery = ~0u;
+		void *fence = nullptr;
+		bool pending = false;
+	};
+
+	bool tryResolve(uint32_t frameSlot);
+	uint32_t getQueryIndex(uint32_t frameSlot, uint32_t scope, uint32_t endQuery) const;
+
+	std::vector<const char *> scopeNames;
+	std::vector<float> scopeTimes;
+	std::vector<uint32_t> queries;
+	std::vector<FrameQueries> frames;
+
+	uint32_t queryBuffer = 0u;
+	const uint64_t *queryBufferMapped = nullptr;
+
+	uint32_t maxScopes = 0u;
+	uint32_t framesInFlight = 0u;
+	uint32_t currentSlot = 0u;
+	bool useQueryBuffer = false;
+};
@@ -0,0 +1,83 @@
+#include "meshregistry.h"
+
+#include "../../external/glad/glad.h"
+#include "rendercommandbuffer.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+MeshRegistry::MeshRegistry(uint32_t vertexSize)
+{
+	assert(vertexSize > 0u && "Mesh vertex size must be greater than 0 bytes");
+	this->vertexSize = vertexSize;
+}
+
+MeshRegistry::~MeshRegistry()
+{
+	delete vertexBuffer;
+	delete indexBuffer;
+}
+
+uint32_t MeshRegistry::addMesh(const void *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount)
+{
+	assert(vertexBuffer == nullptr && "Cannot add meshes after upload");
+
+	MeshInfo info;
+	info.firstIndex = uint32_t(indexData.size());
+	info.indexCount = indexCount;
+	info.baseVertex = int32_t(vertexData.size() / vertexSize);
+	info.vertexCount = vertexCount;
+
+	size_t vertexOffset = vertexData.size();
+	vertexData.resize(vertexOffset + size_t(vertexCount) * vertexSize);
+	memcpy(vertexData.data() + vertexOffset, vertices, size_t(vertexCount) * vertexSize);
+	indexData.insert(indexData.end(), indices, indices + indexCount);
+
+	meshes.push_back(info);
+	return uint32_t(meshes.size() - 1u);
+}
+
+bool MeshRegistry::upload()
+{
+	if(meshes.empty())
+	{
+		printf("Mesh registry has no meshes to upload\n");
+		return false;
+	}
+
+	// Ssbo size has to be multiple of 16 bytes.
+	vertexData.resize((vertexData.size() + 15u) & ~size_t(15u));
+
+	vertexBuffer = new ShaderBuffer(GL_SHADER_STORAGE_BUFFER, uint32_t(vertexData.size()), 0, vertexData.data(), true);
+	indexBuffer = new ShaderBuffer(GL_ELEMENT_ARRAY_BUFFER, uint32_t(indexData.size() * sizeof(uint32_t)), 0,
+		indexData.data(), true);
+	return true;
+}
+
+void MeshRegistry::bind(RenderCommandBuffer &commands, uint32_t vertexSlot) const
+{
+	commands.bindStorage(vertexSlot, *vertexBuffer);
+	commands.setElementBuffer(indexBuffer->handle);
+}
+
+DrawElementsIndirectCommand MeshRegistry::getDrawCommand(uint32_t meshIndex, uint32_t baseInstance,
+	uint32_t instanceCount) const
+{
+	const MeshInfo &mesh = meshes[ meshIndex ];
+	return DrawElementsIndirectCommand{ .count = mesh.indexCount, .instanceCount = instanceCount,
+		.firstIndex = mesh.firstIndex, .baseVertex = mesh.baseVertex, .baseInstance = baseInstance };
+}
+
+void MeshRegistry::drawMesh(RenderCommandBuffer &commands, uint32_t meshIndex, uint32_t baseInstance,
+	uint32_t instanceCount) const
+{
+	const MeshInfo &mesh = meshes[ meshIndex ];
+	commands.drawElementsInstanced(mesh.indexCount, mesh.firstIndex, instanceCount, mesh.baseVertex, baseInstance);
+}
+
+void MeshRegistry::drawIndirect(RenderCommandBuffer &commands, uint32_t commandBufferHandle, uint32_t offset,
+	uint32_t drawCount) const
+{
+	commands.multiDrawElementsIndirect(commandBufferHandle, offset, drawCount);
+}
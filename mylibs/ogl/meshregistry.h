@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "shaderbuffer.h"
+
+class RenderCommandBuffer;
+
+// Same layout as GL expects for glDrawElementsIndirect / glMultiDrawElementsIndirect with 0 stride.
+struct DrawElementsIndirectCommand
+{
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+struct MeshInfo
+{
+	uint32_t firstIndex = 0u;
+	uint32_t indexCount = 0u;
+	int32_t baseVertex = 0;
+	uint32_t vertexCount = 0u;
+};
+
+// Stores every mesh once in shared vertex and index buffers. Indices are local to the mesh, baseVertex
+// moves them into the shared vertex buffer, so in vertex shader gl_VertexID is index into the vertex ssbo
+// and gl_BaseInstance + gl_InstanceID is index into the instance ssbo.
+class MeshRegistry
+{
+public:
+	MeshRegistry(uint32_t vertexSize);
+	~MeshRegistry();
+
+	// Returns mesh index. Meshes can only be added before upload.
+	uint32_t addMesh(const void *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount);
+	bool upload();
+
+	// Records binding vertices as ssbo into vertexSlot and indices as element array buffer of the current
+	// vertex array.
+	void bind(RenderCommandBuffer &commands, uint32_t vertexSlot) const;
+
+	DrawElementsIndirectCommand getDrawCommand(uint32_t meshIndex, uint32_t baseInstance, uint32_t instanceCount) const;
+	void drawMesh(RenderCommandBuffer &commands, uint32_t meshIndex, uint32_t baseInstance, uint32_t instanceCount) const;
+	// Draws drawCount commands from commandBufferHandle as draw indirect buffer, starting at offset bytes.
+	void drawIndirect(RenderCommandBuffer &commands, uint32_t commandBufferHandle, uint32_t offset,
+		uint32_t drawCount) const;
+
+	uint32_t getMeshCount() const { return uint32_t(meshes.size()); }
+	const MeshInfo &getMesh(uint32_t meshIndex) const { return meshes[ meshIndex ]; }
+
+	ShaderBuffer *vertexBuffer = nullptr;
+	ShaderBuffer *indexBuffer = nullptr;
+
+private:
+	uint32_t vertexSize = 0u;
+	std::vector<uint8_t> vertexData;
+	std::vector<uint32_t> indexData;
+	std::vector<MeshInfo> meshes;
+};
@@ -0,0 +1,241 @@
+#include "quadbatcher.h"
+
+#include "../../external/glad/glad.h"
+#include "rendercommandbuffer.h"
+#include "shader.h"
+#include "textbuffer.h"
+
+#include <cassert>
+#include <cstdio>
+
+// Shader, texture and blend bits, items that match here can go into the same draw.
+static constexpr uint64_t StateMask = 0x0000FFFFFFF00000ull;
+
+uint64_t QuadBatcher::getSortKey(uint32_t layer, uint32_t shader, uint32_t texture, uint32_t blend)
+{
+	assert(layer <= 0xFFFFu && shader <= MaxShaders && texture <= MaxTextures && blend <= 0xFu);
+	return (uint64_t(layer) << 48u) | (uint64_t(shader) << 40u) | (uint64_t(texture) << 24u) | (uint64_t(blend) << 20u);
+}
+
+QuadBatcher::QuadBatcher(uint32_t initialQuads)
+{
+	assert(initialQuads > 0u && "Quad batcher needs room for at least one quad");
+	glCreateVertexArrays(1, &vao);
+	reserveQuads(initialQuads);
+	reserveIndices(initialQuads);
+}
+
+QuadBatcher::~QuadBatcher()
+{
+	delete quadBuffer;
+	delete indexBuffer;
+	if(vao)
+		glDeleteVertexArrays(1, &vao);
+	vao = 0u;
+}
+
+uint32_t QuadBatcher::addShader(Shader &shader)
+{
+	assert(shaders.size() < MaxShaders && "Too many shaders in quad batcher");
+	shaders.push_back(&shader);
+	return uint32_t(shaders.size());
+}
+
+uint32_t QuadBatcher::addTexture(uint32_t textureHandle)
+{
+	assert(textures.size() < MaxTextures && "Too many textures in quad batcher");
+	textures.push_back(textureHandle);
+	return uint32_t(textures.size());
+}
+
+void QuadBatcher::addQuad(uint64_t sortKey, const GPUQuad &quad)
+{
+	items.push_back(SortItem{ sortKey, uint32_t(quads.size()) });
+	quads.push_back(quad);
+}
+
+void QuadBatcher::addQuads(uint64_t sortKey, const GPUQuad *newQuads, uint32_t quadCount)
+{
+	uint32_t first = uint32_t(quads.size());
+	quads.insert(quads.end(), newQuads, newQuads + quadCount);
+	for(uint32_t i = 0; i < quadCount; ++i)
+		items.push_back(SortItem{ sortKey, first + i });
+}
+
+void QuadBatcher::addText(uint64_t sortKey, TextBuffer &textBuffer)
+{
+	reserveIndices(textBuffer.getMaxGlyphs());
+	items.push_back(SortItem{ sortKey, uint32_t(texts.size()) | TextItemBit });
+	texts.push_back(&textBuffer);
+}
+
+void QuadBatcher::reserveQuads(uint32_t quadCount)
+{
+	if(quadCount <= quadCapacity)
+		return;
+
+	// Old buffer can still be in use by the gpu, deleting it only drops our handle. New buffer is created
+	// first, so it never gets the old name that GlStateCache could still have as bound.
+	quadCapacity = quadCount > quadCapacity * 2u ? quadCount : quadCapacity * 2u;
+	ShaderBuffer *oldBuffer = quadBuffer;
+	quadBuffer = new ShaderBuffer(GL_SHADER_STORAGE_BUFFER, quadCapacity * uint32_t(sizeof(GPUQuad)), 0, nullptr,
+		false, 3u);
+	delete oldBuffer;
+}
+
+void QuadBatcher::reserveIndices(uint32_t quadCount)
+{
+	if(quadCount <= indexQuadCapacity)
+		return;
+
+	indexQuadCapacity = quadCount > indexQuadCapacity * 2u ? quadCount : indexQuadCapacity * 2u;
+	std::vector<uint32_t> indices(size_t(indexQuadCapacity) * 6u);
+	for(uint32_t i = 0; i < indexQuadCapacity; ++i)
+	{
+		indices[ size_t(i) * 6 + 0 ] = i * 4 + 0;
+		indices[ size_t(i) * 6 + 1 ] = i * 4 + 1;
+		indices[ size_t(i) * 6 + 2 ] = i * 4 + 2;
+
+		indices[ size_t(i) * 6 + 3 ] = i * 4 + 0;
+		indices[ size_t(i) * 6 + 4 ] = i * 4 + 2;
+		indices[ size_t(i) * 6 + 5 ] = i * 4 + 3;
+	}
+
+	ShaderBuffer *oldBuffer = indexBuffer;
+	indexBuffer = new ShaderBuffer(GL_ELEMENT_ARRAY_BUFFER, uint32_t(indices.size() * sizeof(uint32_t)), 0,
+		indices.data(), true);
+	glVertexArrayElementBuffer(vao, indexBuffer->handle);
+	delete oldBuffer;
+}
+
+void QuadBatcher::sortItems()
+{
+	sortPasses = 0u;
+	if(items.size() < 2u)
+		return;
+
+	// Bytes that are same in every key need no pass, usually only few of the 8 differ.
+	uint64_t firstKey = items[ 0 ].key;
+	uint64_t differentBits = 0u;
+	for(const SortItem &item : items)
+		differentBits |= item.key ^ firstKey;
+
+	sortScratch.resize(items.size());
+	for(uint32_t shift = 0u; shift < 64u; shift += 8u)
+	{
+		if(((differentBits >> shift) & 0xFFu) == 0u)
+			continue;
+
+		// Lsd radix sort, every pass is stable.
+		uint32_t offsets[ 256 ] = {};
+		for(const SortItem &item : items)
+			++offsets[ (item.key >> shift) & 0xFFu ];
+
+		uint32_t sum = 0u;
+		for(uint32_t i = 0; i < 256u; ++i)
+		{
+			uint32_t count = offsets[ i ];
+			offsets[ i ] = sum;
+			sum += count;
+		}
+
+		for(const SortItem &item : items)
+			sortScratch[ offsets[ (item.key >> shift) & 0xFFu ]++ ] = item;
+		items.swap(sortScratch);
+		++sortPasses;
+	}
+}
+
+void QuadBatcher::setState(RenderCommandBuffer &commands, uint64_t key, float windowWidth, float windowHeight)
+{
+	uint32_t shader = uint32_t(key >> 40u) & 0xFFu;
+	uint32_t texture = uint32_t(key >> 24u) & 0xFFFFu;
+	uint32_t blend = uint32_t(key >> 20u) & 0xFu;
+
+	if(shader != boundShader)
+	{
+		boundShader = shader;
+		if(shader > 0u)
+		{
+			commands.setProgram(*shaders[ shader - 1u ]);
+			commands.setUniform2f(0, windowWidth, windowHeight);
+		}
+	}
+
+	if(texture != boundTexture)
+	{
+		boundTexture = texture;
+		if(texture > 0u)
+			commands.bindTexture(0, textures[ texture - 1u ]);
+	}
+
+	if(blend != boundBlend)
+	{
+		boundBlend = blend;
+		commands.setBlend(blend);
+	}
+}
+
+void QuadBatcher::flush(RenderCommandBuffer &commands, float windowWidth, float windowHeight)
+{
+	drawCount = 0u;
+	quadCount = uint32_t(quads.size());
+	sortItems();
+
+	uint32_t quadOffset = 0u;
+	if(quadCount > 0u)
+	{
+		reserveQuads(quadCount);
+		reserveIndices(quadCount);
+
+		// Quads go in sorted order, so every run of same state is one index range.
+		GPUQuad *sortedQuads = (GPUQuad *)quadBuffer->allocate(quadCount * uint32_t(sizeof(GPUQuad)), quadOffset);
+		uint32_t quadIndex = 0u;
+		for(const SortItem &item : items)
+		{
+			if((item.index & TextItemBit) == 0u)
+				sortedQuads[ quadIndex++ ] = quads[ item.index ];
+		}
+	}
+
+	// Element buffer is vertex array state, other code binding its own indices could have changed it.
+	commands.setVertexArray(vao);
+	commands.setElementBuffer(indexBuffer->handle);
+	boundShader = ~0u;
+	boundTexture = ~0u;
+	boundBlend = ~0u;
+
+	uint32_t quadIndex = 0u;
+	for(uint32_t i = 0; i < uint32_t(items.size());)
+	{
+		const SortItem &item = items[ i ];
+		setState(commands, item.key, windowWidth, windowHeight);
+
+		if(item.index & TextItemBit)
+		{
+			TextBuffer &textBuffer = *texts[ item.index & ~TextItemBit ];
+			textBuffer.upload();
+			textBuffer.draw(commands, 0u, 2u);
+			++drawCount;
+			++i;
+			continue;
+		}
+
+		uint32_t runStart = quadIndex;
+		while(i < uint32_t(items.size()) && (items[ i ].index & TextItemBit) == 0u &&
+			(items[ i ].key & StateMask) == (item.key & StateMask))
+		{
+			++quadIndex;
+			++i;
+		}
+
+		// Text draws use slot 0 too, state cache drops the bind when nothing came between.
+		commands.bindStorage(0u, quadBuffer->handle, quadOffset, quadCount * uint32_t(sizeof(GPUQuad)));
+		commands.drawElements((quadIndex - runStart) * 6u, runStart * 6u);
+		++drawCount;
+	}
+
+	quads.clear();
+	texts.clear();
+	items.clear();
+}
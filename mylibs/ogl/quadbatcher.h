@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "glstatecache.h"
+#include "shaderbuffer.h"
+
+class RenderCommandBuffer;
+class Shader;
+class TextBuffer;
+
+// Layout colorquad.vert reads, 32 bytes. Position is quad center in pixels, uv rect is for textured quads.
+struct GPUQuad
+{
+	float posX;
+	float posY;
+	uint16_t sizeX;
+	uint16_t sizeY;
+	uint32_t color;
+
+	float uvX;
+	float uvY;
+	float uvWidth;
+	float uvHeight;
+};
+
+// Collects quads and retained text for a frame and draws them ordered by 64 bit sort key. Keys are radix
+// sorted, so items with the same key keep their submit order, and following items with the same shader,
+// texture and blend become one draw even across layers. Owns the quad index buffer and vertex array every
+// quad draw uses, and grows both and the quad ssbo when a frame needs more.
+class QuadBatcher
+{
+public:
+	static constexpr uint32_t BlendOpaque = GlStateCache::BlendOpaque;
+	static constexpr uint32_t BlendAlpha = GlStateCache::BlendAlpha;
+	static constexpr uint32_t BlendAdditive = GlStateCache::BlendAdditive;
+
+	static constexpr uint32_t MaxShaders = 255u;
+	static constexpr uint32_t MaxTextures = 65535u;
+
+	// Bits from the top: layer 16, shader 8, texture 16, blend 4. Lower layers draw first.
+	static uint64_t getSortKey(uint32_t layer, uint32_t shader, uint32_t texture, uint32_t blend);
+
+	QuadBatcher(uint32_t initialQuads = 1024u);
+	~QuadBatcher();
+	QuadBatcher(const QuadBatcher &) = delete;
+	QuadBatcher &operator=(const QuadBatcher &) = delete;
+
+	// Returns shader id for sort keys, starting from 1, id 0 keeps the current program. Shaders get windowSize
+	// in uniform location 0.
+	uint32_t addShader(Shader &shader);
+	// Returns texture id for sort keys, starting from 1. Texture goes to texture unit 0, id 0 leaves unit as is.
+	uint32_t addTexture(uint32_t textureHandle);
+
+	void addQuad(uint64_t sortKey, const GPUQuad &quad);
+	void addQuads(uint64_t sortKey, const GPUQuad *quads, uint32_t quadCount);
+	// Text gets uploaded on flush and drawn with its own multi draw, runs into ssbo slot 0 and glyphs into slot 2.
+	void addText(uint64_t sortKey, TextBuffer &textBuffer);
+
+	// Sorts and uploads everything added since last flush and records the draws. Quads go to ssbo slot 0.
+	void flush(RenderCommandBuffer &commands, float windowWidth, float windowHeight);
+	// Call once per frame after the commands are submitted, quad ssbo is streamed with a region per frame.
+	void endFrame() { quadBuffer->endFrame(); }
+
+	// Stats of the last flush.
+	uint32_t drawCount = 0u;
+	uint32_t quadCount = 0u;
+	uint32_t sortPasses = 0u;
+
+	ShaderBuffer *quadBuffer = nullptr;
+	ShaderBuffer *indexBuffer = nullptr;
+	uint32_t vao = 0u;
+
+private:
+	struct SortItem
+	{
+		uint64_t key;
+		// Quad index, or text index with TextItemBit.
+		uint32_t index;
+	};
+	static constexpr uint32_t TextItemBit = 0x80000000u;
+
+	void reserveQuads(uint32_t quadCapacity);
+	void reserveIndices(uint32_t quadCapacity);
+	void sortItems();
+	void setState(RenderCommandBuffer &commands, uint64_t key, float windowWidth, float windowHeight);
+
+	std::vector<Shader *> shaders;
+	std::vector<uint32_t> textures;
+
+	std::vector<GPUQuad> quads;
+	std::vector<TextBuffer *> texts;
+	std::vector<SortItem> items;
+	std::vector<SortItem> sortScratch;
+
+	uint32_t quadCapacity = 0u;
+	uint32_t indexQuadCapacity = 0u;
+	uint32_t boundShader = ~0u;
+	uint32_t boundTexture = ~0u;
+	uint32_t boundBlend = ~0u;
+};
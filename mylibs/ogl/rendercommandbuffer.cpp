@@ -0,0 +1,216 @@
+#include "rendercommandbuffer.h"
+
+#include "../../external/glad/glad.h"
+#include "glstatecache.h"
+#include "shader.h"
+#include "shaderbuffer.h"
+
+#include <cstring>
+
+static constexpr uint32_t CommandSetProgram = 0u;
+static constexpr uint32_t CommandUniform1f = 1u;
+static constexpr uint32_t CommandUniform1ui = 2u;
+static constexpr uint32_t CommandUniform2f = 3u;
+static constexpr uint32_t CommandUniform4f = 4u;
+static constexpr uint32_t CommandVertexArray = 5u;
+static constexpr uint32_t CommandElementBuffer = 6u;
+static constexpr uint32_t CommandStorage = 7u;
+static constexpr uint32_t CommandTexture = 8u;
+static constexpr uint32_t CommandBlend = 9u;
+static constexpr uint32_t CommandDrawElements = 10u;
+static constexpr uint32_t CommandDrawElementsInstanced = 11u;
+static constexpr uint32_t CommandMultiDrawIndirect = 12u;
+static constexpr uint32_t CommandDispatch = 13u;
+static constexpr uint32_t CommandMemoryBarrier = 14u;
+static constexpr uint32_t CommandViewport = 15u;
+
+static uint32_t floatBits(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(float));
+	return bits;
+}
+
+static float bitsFloat(uint32_t bits)
+{
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+void RenderCommandBuffer::add(uint32_t type, uint32_t a, uint32_t b, uint32_t c, uint32_t d, uint32_t e)
+{
+	commands.push_back(RenderCommand{ .type = type, .args = { a, b, c, d, e, 0u, 0u } });
+}
+
+void RenderCommandBuffer::setProgram(const Shader &shader)
+{
+	add(CommandSetProgram, shader.getProgram());
+}
+
+void RenderCommandBuffer::setUniform1f(uint32_t location, float x)
+{
+	add(CommandUniform1f, location, floatBits(x));
+}
+
+void RenderCommandBuffer::setUniform1ui(uint32_t location, uint32_t x)
+{
+	add(CommandUniform1ui, location, x);
+}
+
+void RenderCommandBuffer::setUniform2f(uint32_t location, float x, float y)
+{
+	add(CommandUniform2f, location, floatBits(x), floatBits(y));
+}
+
+void RenderCommandBuffer::setUniform4f(uint32_t location, const float *values)
+{
+	add(CommandUniform4f, location, floatBits(values[ 0 ]), floatBits(values[ 1 ]), floatBits(values[ 2 ]),
+		floatBits(values[ 3 ]));
+}
+
+void RenderCommandBuffer::setVertexArray(uint32_t vao)
+{
+	add(CommandVertexArray, vao);
+}
+
+void RenderCommandBuffer::setElementBuffer(uint32_t buffer)
+{
+	add(CommandElementBuffer, buffer);
+}
+
+void RenderCommandBuffer::bindStorage(uint32_t slot, const ShaderBuffer &buffer)
+{
+	if(buffer.streamingFrames > 0u && buffer.lastSize > 0u)
+		add(CommandStorage, slot, buffer.handle, buffer.lastOffset, buffer.lastSize);
+	else
+		add(CommandStorage, slot, buffer.handle, 0u, 0u);
+}
+
+void RenderCommandBuffer::bindStorage(uint32_t slot, uint32_t buffer, uint32_t offset, uint32_t size)
+{
+	add(CommandStorage, slot, buffer, offset, size);
+}
+
+void RenderCommandBuffer::bindTexture(uint32_t unit, uint32_t texture)
+{
+	add(CommandTexture, unit, texture);
+}
+
+void RenderCommandBuffer::setBlend(uint32_t blend)
+{
+	add(CommandBlend, blend);
+}
+
+void RenderCommandBuffer::setViewport(uint32_t width, uint32_t height)
+{
+	add(CommandViewport, width, height);
+}
+
+void RenderCommandBuffer::drawElements(uint32_t indexCount, uint32_t firstIndex)
+{
+	add(CommandDrawElements, indexCount, firstIndex);
+}
+
+void RenderCommandBuffer::drawElementsInstanced(uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount,
+	int32_t baseVertex, uint32_t baseInstance)
+{
+	add(CommandDrawElementsInstanced, indexCount, firstIndex, instanceCount, uint32_t(baseVertex), baseInstance);
+}
+
+void RenderCommandBuffer::multiDrawElementsIndirect(uint32_t indirectBuffer, uint32_t offset, uint32_t drawCount)
+{
+	add(CommandMultiDrawIndirect, indirectBuffer, offset, drawCount);
+}
+
+void RenderCommandBuffer::dispatchCompute(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ)
+{
+	add(CommandDispatch, groupsX, groupsY, groupsZ);
+}
+
+void RenderCommandBuffer::memoryBarrier(uint32_t barrierBits)
+{
+	add(CommandMemoryBarrier, barrierBits);
+}
+
+void RenderCommandBuffer::submit(GlStateCache &cache)
+{
+	for(const RenderCommand &command : commands)
+	{
+		const uint32_t *args = command.args;
+		switch(command.type)
+		{
+			case CommandSetProgram:
+				cache.useProgram(args[ 0 ]);
+				break;
+
+			// Uniforms are program state, they always go through.
+			case CommandUniform1f:
+				glUniform1f(GLint(args[ 0 ]), bitsFloat(args[ 1 ]));
+				++cache.issuedCalls;
+				break;
+			case CommandUniform1ui:
+				glUniform1ui(GLint(args[ 0 ]), args[ 1 ]);
+				++cache.issuedCalls;
+				break;
+			case CommandUniform2f:
+				glUniform2f(GLint(args[ 0 ]), bitsFloat(args[ 1 ]), bitsFloat(args[ 2 ]));
+				++cache.issuedCalls;
+				break;
+			case CommandUniform4f:
+				glUniform4f(GLint(args[ 0 ]), bitsFloat(args[ 1 ]), bitsFloat(args[ 2 ]), bitsFloat(args[ 3 ]),
+					bitsFloat(args[ 4 ]));
+				++cache.issuedCalls;
+				break;
+
+			case CommandVertexArray:
+				cache.bindVertexArray(args[ 0 ]);
+				break;
+			case CommandElementBuffer:
+				cache.bindElementBuffer(args[ 0 ]);
+				break;
+			case CommandStorage:
+				cache.bindStorageBuffer(args[ 0 ], args[ 1 ], args[ 2 ], args[ 3 ]);
+				break;
+			case CommandTexture:
+				cache.bindTexture(args[ 0 ], args[ 1 ]);
+				break;
+			case CommandBlend:
+				cache.setBlend(args[ 0 ]);
+				break;
+			case CommandViewport:
+				cache.setViewport(args[ 0 ], args[ 1 ]);
+				break;
+
+			case CommandDrawElements:
+				glDrawElements(GL_TRIANGLES, GLsizei(args[ 0 ]), GL_UNSIGNED_INT,
+					(const void *)(size_t(args[ 1 ]) * sizeof(uint32_t)));
+				++cache.issuedCalls;
+				break;
+			case CommandDrawElementsInstanced:
+				glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, GLsizei(args[ 0 ]), GL_UNSIGNED_INT,
+					(const void *)(size_t(args[ 1 ]) * sizeof(uint32_t)), GLsizei(args[ 2 ]), GLint(int32_t(args[ 3 ])),
+					args[ 4 ]);
+				++cache.issuedCalls;
+				break;
+			case CommandMultiDrawIndirect:
+				cache.bindDrawIndirectBuffer(args[ 0 ]);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void *)size_t(args[ 1 ]),
+					GLsizei(args[ 2 ]), 0);
+				++cache.issuedCalls;
+				break;
+			case CommandDispatch:
+				glDispatchCompute(args[ 0 ], args[ 1 ], args[ 2 ]);
+				++cache.issuedCalls;
+				break;
+			case CommandMemoryBarrier:
+				glMemoryBarrier(args[ 0 ]);
+				++cache.issuedCalls;
+				break;
+
+			default:
+				break;
+		}
+	}
+	commands.clear();
+}
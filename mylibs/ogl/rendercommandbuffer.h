@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+class GlStateCache;
+class Shader;
+class ShaderBuffer;
+
+struct RenderCommand
+{
+	uint32_t type;
+	uint32_t args[ 7 ];
+};
+
+// Records state changes, draws and dispatches as plain packets, and issues them through GlStateCache on
+// submit, so redundant binds between packets never reach the driver. Recording makes no GL calls. Draws
+// are triangles with 32 bit indices.
+class RenderCommandBuffer
+{
+public:
+	void setProgram(const Shader &shader);
+	void setUniform1f(uint32_t location, float x);
+	void setUniform1ui(uint32_t location, uint32_t x);
+	void setUniform2f(uint32_t location, float x, float y);
+	void setUniform4f(uint32_t location, const float *values);
+
+	void setVertexArray(uint32_t vao);
+	void setElementBuffer(uint32_t buffer);
+	// Streaming buffers bind the range written last, like ShaderBuffer::bind.
+	void bindStorage(uint32_t slot, const ShaderBuffer &buffer);
+	// size 0 binds the whole buffer.
+	void bindStorage(uint32_t slot, uint32_t buffer, uint32_t offset = 0u, uint32_t size = 0u);
+	void bindTexture(uint32_t unit, uint32_t texture);
+	void setBlend(uint32_t blend);
+	void setViewport(uint32_t width, uint32_t height);
+
+	void drawElements(uint32_t indexCount, uint32_t firstIndex);
+	void drawElementsInstanced(uint32_t indexCount, uint32_t firstIndex, uint32_t instanceCount, int32_t baseVertex,
+		uint32_t baseInstance);
+	// Reads drawCount DrawElementsIndirectCommands from indirectBuffer starting at offset bytes.
+	void multiDrawElementsIndirect(uint32_t indirectBuffer, uint32_t offset, uint32_t drawCount);
+	void dispatchCompute(uint32_t groupsX, uint32_t groupsY, uint32_t groupsZ);
+	void memoryBarrier(uint32_t barrierBits);
+
+	// Issues every recorded command in order and clears the buffer.
+	void submit(GlStateCache &cache);
+	void clear() { commands.clear(); }
+	uint32_t getCommandCount() const { return uint32_t(commands.size()); }
+
+private:
+	void add(uint32_t type, uint32_t a = 0u, uint32_t b = 0u, uint32_t c = 0u, uint32_t d = 0u, uint32_t e = 0u);
+
+	std::vector<RenderCommand> commands;
+};
@@ -4,10 +4,15 @@
 #include <cstdio>
 #include <cstdlib>
 #include <string>
+#include <string_view>
+#include <cstring>
+#include <chrono>
+#include <vector>
 #include <filesystem>
 #include <fstream>
 
 #include "../../external/glad/glad.h"
+#include "../core/vfs.h"
 
 Shader::~Shader()
 {
@@ -17,12 +22,15 @@ Shader::~Shader()
 	printf("deleting program\n");
 }
 
-static unsigned int shaderFromSource(const char *src, unsigned int shaderType)
+static unsigned int shaderFromSource(std::string_view src, unsigned int shaderType)
 {
 	unsigned int shader = 0;
 	shader = glCreateShader(shaderType);
 
-	glShaderSource(shader, 1, &src, NULL);
+	// Text comes straight from the mapped file, so it is not null terminated.
+	const char *srcPtr = src.data();
+	GLint srcLength = GLint(src.length());
+	glShaderSource(shader, 1, &srcPtr, &srcLength);
 	glCompileShader(shader);
 	
 	int  success = 0;
@@ -57,38 +65,189 @@ static unsigned int shaderFromSource(const char *src, unsigned int shaderType)
 }
 
 
-static bool loadShaderFile(const char *filename, std::string &outShaderText)
+static bool loadShaderFile(const char *filename, std::string_view &outShaderText)
 {
-	if (std::filesystem::exists(filename))
+	outShaderText = core::getVfs().getText(filename);
+	if(outShaderText.empty())
 	{
-		std::filesystem::path p(filename);
-		uint32_t s = uint32_t(std::filesystem::file_size(p));
+		printf("Shader file: %s does not exist\n", filename);
+		return false;
+	}
+	return true;
+}
 
-		outShaderText.resize(s);
 
-		std::ifstream f(p, std::ios::in | std::ios::binary);
 
+// Program binary cache
 
-		f.read(outShaderText.data(), s);
+static constexpr const char *ShaderCacheDirectory = "shader_cache";
+static constexpr uint32_t ShaderCacheMagic = 0x48534843u; // "CHSH"
+static constexpr uint32_t ShaderCacheVersion = 1u;
 
-		printf("Read shader file: %s\n", filename);
-		return true;
+struct ShaderCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t binaryFormat;
+	uint32_t binarySize;
+	// How long the compile and link took when the binary was created.
+	float compileMs;
+	uint32_t padding;
+	uint64_t hash;
+};
+
+static uint64_t hashBytes(uint64_t hash, const char *data, size_t size)
+{
+	// FNV-1a
+	for(size_t i = 0; i < size; ++i)
+	{
+		hash ^= uint64_t(uint8_t(data[i]));
+		hash *= 0x100000001b3ull;
 	}
+	return hash;
+}
 
-	else
+static uint64_t getShaderCacheHash(std::string_view vertShaderText, std::string_view fragShaderText)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const GLenum strs[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for(GLenum strType : strs)
 	{
-		printf("Shader file: %s does not exist\n", filename);
-		return false;
+		const char *str = (const char *)glGetString(strType);
+		if(str)
+			hash = hashBytes(hash, str, strlen(str) + 1);
 	}
+	hash = hashBytes(hash, vertShaderText.data(), vertShaderText.size());
+	// Separator so moving text from one shader to the other changes the hash.
+	hash = hashBytes(hash, "|", 1);
+	hash = hashBytes(hash, fragShaderText.data(), fragShaderText.size());
+	return hash;
+}
+
+static std::filesystem::path getShaderCachePath(uint64_t hash)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+	return std::filesystem::path(ShaderCacheDirectory) / name;
+}
+
+static bool isProgramBinarySupported()
+{
+	int formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+static bool loadProgramBinary(unsigned int programId, uint64_t hash, float &outCompileMs)
+{
+	std::filesystem::path p = getShaderCachePath(hash);
+	std::error_code ec;
+	if(!std::filesystem::exists(p, ec))
+		return false;
 
+	std::ifstream f(p, std::ios::in | std::ios::binary);
+	ShaderCacheHeader header = {};
+	if(!f.read((char *)&header, sizeof(header)))
+		return false;
+
+	if(header.magic != ShaderCacheMagic || header.version != ShaderCacheVersion || header.hash != hash)
+		return false;
+
+	std::vector<char> binary(header.binarySize);
+	if(!f.read(binary.data(), header.binarySize))
+		return false;
+
+	glProgramBinary(programId, header.binaryFormat, binary.data(), GLsizei(header.binarySize));
+
+	int success = 0;
+	glGetProgramiv(programId, GL_LINK_STATUS, &success);
+	outCompileMs = header.compileMs;
+	return success != 0;
+}
+
+static void saveProgramBinary(unsigned int programId, uint64_t hash, float compileMs)
+{
+	int binarySize = 0;
+	glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if(binarySize <= 0)
+		return;
+
+	std::vector<char> binary(binarySize);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(programId, binarySize, nullptr, &binaryFormat, binary.data());
+
+	std::error_code ec;
+	std::filesystem::create_directories(ShaderCacheDirectory, ec);
+
+	ShaderCacheHeader header = {};
+	header.magic = ShaderCacheMagic;
+	header.version = ShaderCacheVersion;
+	header.binaryFormat = binaryFormat;
+	header.binarySize = uint32_t(binarySize);
+	header.compileMs = compileMs;
+	header.hash = hash;
+
+	std::filesystem::path p = getShaderCachePath(hash);
+	std::ofstream f(p, std::ios::out | std::ios::binary | std::ios::trunc);
+	f.write((const char *)&header, sizeof(header));
+	f.write(binary.data(), binarySize);
+	if(!f)
+		printf("Failed to write shader cache file: %s\n", p.string().c_str());
+}
+
+static float getMsSince(std::chrono::high_resolution_clock::time_point start)
+{
+	auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+static bool tryLoadCachedProgram(unsigned int &programId, uint64_t hash, const char *shaderNames,
+	std::chrono::high_resolution_clock::time_point startTime)
+{
+	programId = glCreateProgram();
+	float compileMs = 0.0f;
+	if(loadProgramBinary(programId, hash, compileMs))
+	{
+		float loadMs = getMsSince(startTime);
+		printf("Shader cache hit: %s, load: %2.3fms, saved: %2.3fms\n", 
+			shaderNames, loadMs, compileMs - loadMs);
+		return true;
+	}
+	// Binary got rejected or did not exist, driver updates can do this. Start from clean program.
+	glDeleteProgram(programId);
+	programId = 0u;
 	return false;
 }
 
+static bool linkProgram(unsigned int &programId, const unsigned int *shaders, uint32_t shaderCount, bool useCache)
+{
+	programId = glCreateProgram();
+	if(useCache)
+		glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+	for(uint32_t i = 0; i < shaderCount; ++i)
+		glAttachShader(programId, shaders[i]);
+	glLinkProgram(programId);
+
+	for(uint32_t i = 0; i < shaderCount; ++i)
+		glDeleteShader(shaders[i]);
+
+	int  success = 0;
+	glGetProgramiv(programId, GL_LINK_STATUS, &success);
+	if(!success)
+	{
+		char infoLog[1024];
+		glGetProgramInfoLog(programId, 1024, NULL, infoLog);
+		printf("ERROR::Shader linking failed: %s\n", infoLog);
+		return false;
+	}
+	return true;
+}
 
 bool Shader::initShader(const char *vertShaderFilename, const char *fragShaderFilename)
 {
-	std::string vertShaderText;
-	std::string fragShaderText;
+	std::string_view vertShaderText;
+	std::string_view fragShaderText;
 
 	if (!loadShaderFile(vertShaderFilename, vertShaderText))
 	{
@@ -102,14 +261,25 @@ bool Shader::initShader(const char *vertShaderFilename, const char *fragShaderFi
 		return false;
 	}
 
-	unsigned int vertexShader = shaderFromSource(vertShaderText.c_str(), GL_VERTEX_SHADER);
+	std::string shaderNames = std::string(vertShaderFilename) + ", " + fragShaderFilename;
+	auto startTime = std::chrono::high_resolution_clock::now();
+	bool useCache = isProgramBinarySupported();
+	uint64_t hash = 0u;
+	if(useCache)
+	{
+		hash = getShaderCacheHash(vertShaderText, fragShaderText);
+		if(tryLoadCachedProgram(programId, hash, shaderNames.c_str(), startTime))
+			return true;
+	}
+
+	unsigned int vertexShader = shaderFromSource(vertShaderText, GL_VERTEX_SHADER);
 	if(vertexShader == 0)
 	{
 		printf("Error at compiling vertex shader\n");
 		return false;
 	}
 	
-	unsigned int fragmentShader = shaderFromSource(fragShaderText.c_str(), GL_FRAGMENT_SHADER);
+	unsigned int fragmentShader = shaderFromSource(fragShaderText, GL_FRAGMENT_SHADER);
 	if(fragmentShader == 0)
 	{
 		glDeleteShader(vertexShader);
@@ -117,29 +287,60 @@ bool Shader::initShader(const char *vertShaderFilename, const char *fragShaderFi
 		return false;
 	}
 
-	programId = glCreateProgram();
+	const unsigned int shaders[] = { vertexShader, fragmentShader };
+	if(!linkProgram(programId, shaders, 2u, useCache))
+		return false;
 
-	glAttachShader(programId, vertexShader);
-	glAttachShader(programId, fragmentShader);
-	glLinkProgram(programId);
+	if(useCache)
+	{
+		float compileMs = getMsSince(startTime);
+		printf("Shader cache miss: %s, compile: %2.3fms\n", shaderNames.c_str(), compileMs);
+		saveProgramBinary(programId, hash, compileMs);
+	}
 
-	int  success = 0;
-	glGetProgramiv(programId, GL_LINK_STATUS, &success);
-	if(!success)
+	return true;
+
+}
+
+bool Shader::initComputeShader(const char *computeShaderFilename)
+{
+	std::string_view computeShaderText;
+
+	if (!loadShaderFile(computeShaderFilename, computeShaderText))
 	{
-		char infoLog[1024];
-		glGetShaderInfoLog(programId, 1024, NULL, infoLog);
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
-		printf("ERROR::Shader linking failed: %s\n", infoLog);
+		printf("Failed to load compute shader: %s\n", computeShaderFilename);
 		return false;
 	}
 
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	auto startTime = std::chrono::high_resolution_clock::now();
+	bool useCache = isProgramBinarySupported();
+	uint64_t hash = 0u;
+	if(useCache)
+	{
+		// Empty fragment text, so compute program never hashes same as vertex + fragment pair.
+		hash = getShaderCacheHash(computeShaderText, std::string_view());
+		if(tryLoadCachedProgram(programId, hash, computeShaderFilename, startTime))
+			return true;
+	}
 
-	return true;
+	unsigned int computeShader = shaderFromSource(computeShaderText, GL_COMPUTE_SHADER);
+	if(computeShader == 0)
+	{
+		printf("Error at compiling compute shader\n");
+		return false;
+	}
 
+	if(!linkProgram(programId, &computeShader, 1u, useCache))
+		return false;
+
+	if(useCache)
+	{
+		float compileMs = getMsSince(startTime);
+		printf("Shader cache miss: %s, compile: %2.3fms\n", computeShaderFilename, compileMs);
+		saveProgramBinary(programId, hash, compileMs);
+	}
+
+	return true;
 }
 
 void Shader::useProgram()
@@ -5,7 +5,9 @@ class Shader
 public:
 	~Shader();
 	bool initShader(const char *vertShaderFilename, const char *fragShaderFilename);
+	bool initComputeShader(const char *computeShaderFilename);
 	void useProgram();
+	unsigned int getProgram() const { return programId; }
 private:
 	unsigned int programId = 0u;
 };
\ No newline at end of file
@@ -3,9 +3,12 @@
 #include "../../external/glad/glad.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 ShaderBuffer::ShaderBuffer(unsigned int bufferType, unsigned int size, unsigned int usage, void *dataPtr,
-	bool immutable)
+	bool immutable, unsigned int streamingFrames)
 {
 	assert(size > 0 && "Buffer size must be greater than 0 bytes");
 	if(bufferType != GL_ELEMENT_ARRAY_BUFFER)
@@ -53,10 +56,12 @@ ShaderBuffer::ShaderBuffer(unsigned int bufferType, unsigned int size, unsigned
 		break;
 
 		default:
-			if(!immutable)
+			if(!immutable && streamingFrames == 0u)
 				assert(0 && "Unknown buffer usage!");
 	}
 
+	assert(streamingFrames <= MaxStreamingFrames && "Too many streaming frames!");
+
 	this->bufferType = bufferType;
 	this->usage = usage;
 	this->size = size;
@@ -65,7 +70,30 @@ ShaderBuffer::ShaderBuffer(unsigned int bufferType, unsigned int size, unsigned
 	this->handle = handle;
 	this->immutable = immutable;
 	assert(handle && "Failed to generate buffer handle!");
-	if(immutable)
+
+	if(streamingFrames > 0u)
+	{
+		// Every frame region has to start at offset usable with glBindBufferRange.
+		int alignment = 16;
+		if(bufferType == GL_SHADER_STORAGE_BUFFER)
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		else if(bufferType == GL_UNIFORM_BUFFER)
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		offsetAlignment = alignment > 16 ? (unsigned int)alignment : 16u;
+		this->size = (size + offsetAlignment - 1u) / offsetAlignment * offsetAlignment;
+
+		this->streamingFrames = streamingFrames;
+		this->immutable = true;
+		this->usage = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+		unsigned int totalSize = this->size * streamingFrames;
+		glNamedBufferStorage(handle, totalSize, nullptr, this->usage);
+		mappedPtr = (unsigned char *)glMapNamedBufferRange(handle, 0, totalSize, this->usage);
+		assert(mappedPtr && "Failed to map streaming buffer!");
+		if(dataPtr)
+			updateBuffer(0, size, dataPtr);
+	}
+	else if(immutable)
 		glNamedBufferStorage(handle, size, dataPtr, usage);
 	else
 		glNamedBufferData(handle, size, dataPtr, usage);
@@ -73,6 +101,16 @@ ShaderBuffer::ShaderBuffer(unsigned int bufferType, unsigned int size, unsigned
 
 ShaderBuffer::~ShaderBuffer()
 {
+	for(unsigned int i = 0; i < MaxStreamingFrames; ++i)
+	{
+		if(frameFences[i])
+			glDeleteSync(GLsync(frameFences[i]));
+		frameFences[i] = nullptr;
+	}
+	if(mappedPtr)
+		glUnmapNamedBuffer(handle);
+	mappedPtr = nullptr;
+
 	glDeleteBuffers(1, &handle);
 	handle = 0;
 
@@ -83,16 +121,93 @@ void ShaderBuffer::updateBuffer(unsigned int offset, unsigned int size, void *da
 	assert(offset + size <= this->size && "trying to write buffer out of range!");
 	assert(dataPtr != nullptr && "No data given to update");
 
+	if(streamingFrames > 0u)
+	{
+		// Bind covers [0, offset + size) of the region, bytes below offset would be from an older frame.
+		assert(offset == 0u && "Streaming buffer updates have to start from offset 0!");
+		if(offset != 0u)
+		{
+			fprintf(stderr, "Streaming buffer update at offset %u, has to start from 0\n", offset);
+			return;
+		}
+
+		// Region is written directly, no driver side copy or implicit sync.
+		unsigned int regionOffset = frameIndex * this->size;
+		memcpy(mappedPtr + regionOffset, dataPtr, size);
+		lastOffset = regionOffset;
+		lastSize = size;
+		frameUsed = frameUsed > size ? frameUsed : size;
+		return;
+	}
+
 	glNamedBufferSubData(handle, offset, size, dataPtr);
 	
 }
 
+void *ShaderBuffer::allocate(unsigned int allocSize, unsigned int &offsetOut)
+{
+	assert(streamingFrames > 0u && "Only streaming buffers can allocate!");
+	unsigned int start = (frameUsed + offsetAlignment - 1u) / offsetAlignment * offsetAlignment;
+	if(start + allocSize > this->size)
+	{
+		fprintf(stderr, "Streaming buffer frame region is full: %u + %u bytes of %u\n", start, allocSize, this->size);
+		fprintf(stderr, "Aborting...\n");
+		abort();
+	}
+
+	frameUsed = start + allocSize;
+	offsetOut = frameIndex * this->size + start;
+	lastOffset = offsetOut;
+	lastSize = allocSize;
+	return mappedPtr + offsetOut;
+}
+
+void ShaderBuffer::endFrame()
+{
+	assert(streamingFrames > 0u && "Only streaming buffers have frames!");
+
+	if(frameFences[frameIndex])
+		glDeleteSync(GLsync(frameFences[frameIndex]));
+	frameFences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	frameIndex = (frameIndex + 1u) % streamingFrames;
+	frameUsed = 0u;
+
+	GLsync fence = GLsync(frameFences[frameIndex]);
+	if(fence)
+	{
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if(result == GL_TIMEOUT_EXPIRED)
+		{
+			++stallCount;
+			do
+			{
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000u);
+			} while(result == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(fence);
+		frameFences[frameIndex] = nullptr;
+	}
+}
+
 void ShaderBuffer::bind(unsigned int slot)
 {
+	if(streamingFrames > 0u && lastSize > 0u)
+	{
+		bindRange(slot, lastOffset, lastSize);
+		return;
+	}
 	glBindBufferBase(bufferType, slot, handle);
 	boundSlot = slot;
 }
 
+void ShaderBuffer::bindRange(unsigned int slot, unsigned int offset, unsigned int size)
+{
+	assert(size > 0u && "Binding empty range!");
+	glBindBufferRange(bufferType, slot, handle, offset, size);
+	boundSlot = slot;
+}
+
 void ShaderBuffer::unbind()
 {
 	glBindBufferBase(bufferType, boundSlot, 0);
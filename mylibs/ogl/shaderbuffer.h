@@ -3,14 +3,28 @@
 class ShaderBuffer
 {
 public:
+	// streamingFrames > 0 creates persistently mapped ring buffer with streamingFrames regions of size bytes,
+	// each guarded by fence. usage and immutable are ignored for streaming buffers.
 	ShaderBuffer(unsigned int bufferType, unsigned int size, unsigned int usasge, 
-		void *dataPtr = nullptr, bool immutable = false);
+		void *dataPtr = nullptr, bool immutable = false, unsigned int streamingFrames = 0u);
 	~ShaderBuffer();
 
+	// For streaming buffers the data is written into the current frame region, and bind uses that range.
+	// Other regions hold older frames, so streaming writes have to start at offset 0 and cover everything
+	// the frame uses, nonzero offset gets rejected.
 	void updateBuffer(unsigned int offset, unsigned int size, void *dataPtr);
 	void bind(unsigned int slot);
+	void bindRange(unsigned int slot, unsigned int offset, unsigned int size);
 	void unbind();
 
+	// Streaming buffers only. Returns write pointer into current frame region, offset is from the start of the buffer.
+	// Never returns nullptr, running out of the region is a sizing bug and aborts in every build.
+	void *allocate(unsigned int allocSize, unsigned int &offsetOut);
+	// Streaming buffers only. Fences the current region and moves to the next one, waiting if gpu still uses it.
+	void endFrame();
+
+	static constexpr unsigned int MaxStreamingFrames = 4u;
+
 public:
 	unsigned int handle = 0;
 	unsigned int bufferType = 0;
@@ -19,4 +33,16 @@ public:
 
 	unsigned int boundSlot = 0u;
 	bool immutable = false;
+
+	// Streaming
+	unsigned char *mappedPtr = nullptr;
+	void *frameFences[MaxStreamingFrames] = {};
+	unsigned int streamingFrames = 0u;
+	unsigned int frameIndex = 0u;
+	unsigned int frameUsed = 0u;
+	unsigned int offsetAlignment = 16u;
+	unsigned int lastOffset = 0u;
+	unsigned int lastSize = 0u;
+	// How many times endFrame had to wait for the gpu.
+	unsigned int stallCount = 0u;
 };
@@ -0,0 +1,225 @@
+#include "textbuffer.h"
+
+#include "../../external/glad/glad.h"
+#include "../core/utf8.h"
+#include "glyphatlas.h"
+#include "rendercommandbuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+TextBuffer::TextBuffer(uint32_t maxGlyphs, uint32_t maxBlocks) :
+	runBuffer(GL_SHADER_STORAGE_BUFFER, maxBlocks * uint32_t(sizeof(GPUTextRun)), GL_DYNAMIC_STORAGE_BIT, nullptr, true),
+	// Ssbo size has to be multiple of 16 bytes.
+	glyphBuffer(GL_SHADER_STORAGE_BUFFER, (maxGlyphs * 2u + 15u) & ~15u, GL_DYNAMIC_STORAGE_BIT, nullptr, true),
+	commandBuffer(GL_DRAW_INDIRECT_BUFFER, maxBlocks * uint32_t(sizeof(DrawElementsIndirectCommand)),
+		GL_DYNAMIC_STORAGE_BIT, nullptr, true)
+{
+	assert(maxGlyphs > 0u && "Text buffer needs room for at least one glyph");
+	assert(maxBlocks > 0u && "Text buffer needs room for at least one block");
+
+	this->maxBlocks = maxBlocks;
+	glyphs.resize(glyphBuffer.size / 2u, InvalidGlyph);
+	runs.reserve(maxBlocks);
+	commands.reserve(maxBlocks);
+	glyphBuffer.updateBuffer(0u, glyphBuffer.size, glyphs.data());
+	glyphs.resize(maxGlyphs);
+}
+
+TextBuffer::~TextBuffer()
+{
+	for(const TextBlock &textBlock : blocks)
+	{
+		for(uint32_t i = 0; i < textBlock.glyphCount; ++i)
+			releaseGlyph(glyphs[ textBlock.glyphStart + i ]);
+	}
+}
+
+void TextBuffer::setGlyphAtlas(GlyphAtlas *atlas, uint32_t sizeIndex)
+{
+	assert(usedGlyphs == 0u && "Glyph atlas has to be set before adding blocks");
+	glyphAtlas = atlas;
+	glyphSizeIndex = sizeIndex;
+}
+
+uint32_t TextBuffer::addBlock(uint32_t glyphCapacity, float posX, float posY, uint32_t color)
+{
+	if(usedGlyphs + glyphCapacity > uint32_t(glyphs.size()) || uint32_t(blocks.size()) >= maxBlocks)
+	{
+		printf("Text buffer is full, cannot add block of %u glyphs\n", glyphCapacity);
+		return ~0u;
+	}
+
+	TextBlock textBlock;
+	textBlock.glyphStart = usedGlyphs;
+	textBlock.glyphCapacity = glyphCapacity;
+	textBlock.posX = posX;
+	textBlock.posY = posY;
+	textBlock.color = color;
+	// Reserve up front for 4 byte code points, so setText never allocates.
+	textBlock.text.reserve(glyphCapacity * 4u);
+
+	usedGlyphs += glyphCapacity;
+	blocks.emplace_back(std::move(textBlock));
+	runs.emplace_back(GPUTextRun{});
+	commands.emplace_back(DrawElementsIndirectCommand{});
+
+	uint32_t block = uint32_t(blocks.size() - 1u);
+	markRunDirty(block);
+	return block;
+}
+
+void TextBuffer::setText(uint32_t block, const char *text, uint32_t length)
+{
+	TextBlock &textBlock = blocks[ block ];
+	uint32_t oldLength = uint32_t(textBlock.text.length());
+	uint32_t oldCount = textBlock.glyphCount;
+
+	// Same bytes give same glyphs, as long as the common prefix ends at code point start in both texts.
+	uint32_t prefix = 0u;
+	while(prefix < oldLength && prefix < length && textBlock.text[ prefix ] == text[ prefix ])
+		++prefix;
+	while(prefix > 0u && ((prefix < oldLength && (uint8_t(textBlock.text[ prefix ]) & 0xC0u) == 0x80u) ||
+		(prefix < length && (uint8_t(text[ prefix ]) & 0xC0u) == 0x80u)))
+		--prefix;
+
+	uint32_t index = 0u;
+	uint32_t count = 0u;
+	while(index < prefix)
+	{
+		core::decodeUtf8(text, prefix, index);
+		++count;
+	}
+
+	// Acquire the new glyph before releasing the old one, so unchanged glyphs never drop to 0 references.
+	uint32_t first = ~0u;
+	uint32_t last = 0u;
+	uint16_t *blockGlyphs = glyphs.data() + textBlock.glyphStart;
+	while(index < length && count < textBlock.glyphCapacity)
+	{
+		uint16_t glyph = acquireGlyph(core::decodeUtf8(text, length, index));
+		if(count < oldCount)
+			releaseGlyph(blockGlyphs[ count ]);
+		if(count >= oldCount || blockGlyphs[ count ] != glyph)
+		{
+			blockGlyphs[ count ] = glyph;
+			first = count < first ? count : first;
+			last = count + 1u;
+		}
+		++count;
+	}
+	// Shrinking only changes the header, the glyphs past the end are never drawn.
+	for(uint32_t i = count; i < oldCount; ++i)
+		releaseGlyph(blockGlyphs[ i ]);
+
+	textBlock.text.assign(text, index);
+	textBlock.glyphCount = count;
+	if(first < last)
+		dirtySpans.push_back(GlyphSpan{ textBlock.glyphStart + first, textBlock.glyphStart + last });
+	if(oldCount != count)
+		markRunDirty(block);
+}
+
+void TextBuffer::setMetrics(uint32_t block, float posX, float posY, int charWidth, int charHeight)
+{
+	TextBlock &textBlock = blocks[ block ];
+	if(textBlock.posX == posX && textBlock.posY == posY &&
+		textBlock.charWidth == charWidth && textBlock.charHeight == charHeight)
+		return;
+
+	textBlock.posX = posX;
+	textBlock.posY = posY;
+	textBlock.charWidth = charWidth;
+	textBlock.charHeight = charHeight;
+	markRunDirty(block);
+}
+
+void TextBuffer::markRunDirty(uint32_t block)
+{
+	dirtyRunBegin = block < dirtyRunBegin ? block : dirtyRunBegin;
+	dirtyRunEnd = block + 1u > dirtyRunEnd ? block + 1u : dirtyRunEnd;
+}
+
+uint16_t TextBuffer::acquireGlyph(uint32_t codePoint)
+{
+	if(glyphAtlas)
+		return uint16_t(glyphAtlas->acquire(glyphSizeIndex, codePoint));
+	return codePoint >= 32u && codePoint < 128u ? uint16_t(codePoint - 32u) : InvalidGlyph;
+}
+
+void TextBuffer::releaseGlyph(uint16_t glyph)
+{
+	if(glyphAtlas && glyph != InvalidGlyph)
+		glyphAtlas->release(glyph);
+}
+
+uint32_t TextBuffer::upload()
+{
+	uint32_t uploadedBytes = 0u;
+	if(!dirtySpans.empty())
+	{
+		std::sort(dirtySpans.begin(), dirtySpans.end(),
+			[](const GlyphSpan &a, const GlyphSpan &b) { return a.begin < b.begin; });
+
+		GlyphSpan span = dirtySpans[ 0 ];
+		for(uint32_t i = 1; i <= uint32_t(dirtySpans.size()); ++i)
+		{
+			if(i < uint32_t(dirtySpans.size()) && dirtySpans[ i ].begin <= span.end)
+			{
+				span.end = dirtySpans[ i ].end > span.end ? dirtySpans[ i ].end : span.end;
+				continue;
+			}
+
+			glyphBuffer.updateBuffer(span.begin * 2u, (span.end - span.begin) * 2u, glyphs.data() + span.begin);
+			uploadedBytes += (span.end - span.begin) * 2u;
+
+			if(i < uint32_t(dirtySpans.size()))
+				span = dirtySpans[ i ];
+		}
+		dirtySpans.clear();
+	}
+
+	if(dirtyRunBegin < dirtyRunEnd)
+	{
+		for(uint32_t i = dirtyRunBegin; i < dirtyRunEnd; ++i)
+		{
+			const TextBlock &textBlock = blocks[ i ];
+			uint32_t length = textBlock.glyphCount;
+
+			GPUTextRun &run = runs[ i ];
+			run.posX = textBlock.posX;
+			run.posY = textBlock.posY;
+			run.charWidth = uint16_t(textBlock.charWidth);
+			run.charHeight = uint16_t(textBlock.charHeight);
+			run.color = textBlock.color;
+			run.glyphStart = textBlock.glyphStart;
+			run.length = length;
+
+			// Empty blocks stay in the multi draw with 0 instances.
+			commands[ i ] = DrawElementsIndirectCommand{ .count = length * 6u, .instanceCount = length > 0u ? 1u : 0u,
+				.firstIndex = textBlock.glyphStart * 6u, .baseVertex = 0, .baseInstance = i };
+		}
+
+		uint32_t runCount = dirtyRunEnd - dirtyRunBegin;
+		runBuffer.updateBuffer(dirtyRunBegin * uint32_t(sizeof(GPUTextRun)), runCount * uint32_t(sizeof(GPUTextRun)),
+			runs.data() + dirtyRunBegin);
+		commandBuffer.updateBuffer(dirtyRunBegin * uint32_t(sizeof(DrawElementsIndirectCommand)),
+			runCount * uint32_t(sizeof(DrawElementsIndirectCommand)), commands.data() + dirtyRunBegin);
+		uploadedBytes += runCount * uint32_t(sizeof(GPUTextRun) + sizeof(DrawElementsIndirectCommand));
+
+		dirtyRunBegin = ~0u;
+		dirtyRunEnd = 0u;
+	}
+	return uploadedBytes;
+}
+
+void TextBuffer::draw(RenderCommandBuffer &commands, uint32_t runSlot, uint32_t glyphSlot) const
+{
+	if(blocks.empty())
+		return;
+
+	commands.bindStorage(runSlot, runBuffer);
+	commands.bindStorage(glyphSlot, glyphBuffer);
+	commands.multiDrawElementsIndirect(commandBuffer.handle, 0u, uint32_t(blocks.size()));
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "meshregistry.h"
+#include "shaderbuffer.h"
+
+class GlyphAtlas;
+class RenderCommandBuffer;
+
+// Per block header, layout texturedquad.vert reads. Glyph positions and letters are derived in the
+// vertex shader from gl_VertexID and the 16 bit glyph indices.
+struct GPUTextRun
+{
+	float posX;
+	float posY;
+	uint16_t charWidth;
+	uint16_t charHeight;
+	uint32_t color;
+
+	uint32_t glyphStart;
+	uint32_t length;
+	uint32_t padding[2];
+};
+
+// Retained text, owns glyph range [glyphStart, glyphStart + glyphCapacity) of its TextBuffer.
+struct TextBlock
+{
+	uint32_t glyphStart = 0u;
+	uint32_t glyphCapacity = 0u;
+
+	// Utf-8, glyphCount is the decoded code point count.
+	std::string text;
+	uint32_t glyphCount = 0u;
+	float posX = 0.0f;
+	float posY = 0.0f;
+	int charWidth = 8;
+	int charHeight = 12;
+	uint32_t color = 0u;
+};
+
+// Shared text buffers for text blocks. Text is utf-8, every code point becomes a 16 bit glyph index and
+// only the glyph indices and a 32 byte header per block go to the gpu, the vertex shader does the layout.
+// Blocks only mark the glyphs that changed as dirty, and upload sends only the dirty spans, so editing
+// one character uploads two bytes.
+// Without glyph atlas the glyph index is code point - 32 for the fixed 32..127 font of FontBuffer, other
+// code points are InvalidGlyph. With glyph atlas the index is the atlas slot, and blocks hold a reference
+// to every glyph they show.
+class TextBuffer
+{
+public:
+	static constexpr uint16_t InvalidGlyph = 0xFFFFu;
+
+	TextBuffer(uint32_t maxGlyphs, uint32_t maxBlocks = 16u);
+	~TextBuffer();
+	TextBuffer(const TextBuffer &) = delete;
+	TextBuffer &operator=(const TextBuffer &) = delete;
+
+	// Set before any text, glyphs come from sizeIndex of the atlas font. Atlas has to outlive the buffer.
+	void setGlyphAtlas(GlyphAtlas *atlas, uint32_t sizeIndex);
+
+	// Returns block index, or ~0u if the buffer has no room for glyphs or blocks left.
+	uint32_t addBlock(uint32_t glyphCapacity, float posX, float posY, uint32_t color);
+
+	// Text with more code points than block capacity is cut. Only glyphs that differ from the old text
+	// become dirty.
+	void setText(uint32_t block, const char *text, uint32_t length);
+	void setText(uint32_t block, const std::string &text) { setText(block, text.data(), uint32_t(text.length())); }
+	// Moving or resizing only changes the block header.
+	void setMetrics(uint32_t block, float posX, float posY, int charWidth, int charHeight);
+
+	// Uploads dirty character spans, neighbouring spans get merged, and changed headers. Returns uploaded bytes.
+	uint32_t upload();
+	// Records one multi draw indirect of every block, block index goes in as gl_BaseInstance. Needs an
+	// element array buffer of quads, 6 indices per glyph, with at least maxGlyphs quads bound, QuadBatcher::addText
+	// takes care of it.
+	void draw(RenderCommandBuffer &commands, uint32_t runSlot, uint32_t glyphSlot) const;
+
+	const TextBlock &getBlock(uint32_t block) const { return blocks[ block ]; }
+	uint32_t getMaxGlyphs() const { return uint32_t(glyphs.size()); }
+
+	ShaderBuffer runBuffer;
+	ShaderBuffer glyphBuffer;
+	ShaderBuffer commandBuffer;
+
+private:
+	struct GlyphSpan
+	{
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	void markRunDirty(uint32_t block);
+	uint16_t acquireGlyph(uint32_t codePoint);
+	void releaseGlyph(uint16_t glyph);
+
+	std::vector<TextBlock> blocks;
+	std::vector<GPUTextRun> runs;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<uint16_t> glyphs;
+	std::vector<GlyphSpan> dirtySpans;
+	GlyphAtlas *glyphAtlas = nullptr;
+	uint32_t glyphSizeIndex = 0u;
+	uint32_t maxBlocks = 0u;
+	uint32_t usedGlyphs = 0u;
+	uint32_t dirtyRunBegin = ~0u;
+	uint32_t dirtyRunEnd = 0u;
+};
@@ -0,0 +1,588 @@
+#include "entities.h"
+
+#include <cassert>
+#include <cmath>
+
+#if defined(__AVX2__)
+	#define ENTITIES_USE_AVX2 1
+	#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define ENTITIES_USE_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+core::SlotHandle EntityArrays::add(const Entity &entity, uint32_t color, uint32_t meshIndex)
+{
+	posX.push_back(entity.posX);
+	posY.push_back(entity.posY);
+	posZ.push_back(entity.posZ);
+	rotation.push_back(entity.rotation);
+	speedX.push_back(entity.speedX);
+	speedY.push_back(entity.speedY);
+	size.push_back(entity.size);
+	rotationSpeed.push_back(entity.rotationSpeed);
+	this->color.push_back(color);
+	this->meshIndex.push_back(meshIndex);
+	prevPosX.push_back(entity.posX);
+	prevPosY.push_back(entity.posY);
+	prevRotation.push_back(entity.rotation);
+	return slots.add();
+}
+
+template <typename T>
+static void swapRemove(std::vector<T> &values, uint32_t index)
+{
+	values[ index ] = values.back();
+	values.pop_back();
+}
+
+bool EntityArrays::remove(core::SlotHandle handle)
+{
+	uint32_t index = slots.getIndex(handle);
+	if(index == core::SlotMap::InvalidIndex)
+		return false;
+	removeAt(index);
+	return true;
+}
+
+void EntityArrays::removeAt(uint32_t index)
+{
+	slots.removeAt(index);
+	swapRemove(posX, index);
+	swapRemove(posY, index);
+	swapRemove(posZ, index);
+	swapRemove(rotation, index);
+	swapRemove(speedX, index);
+	swapRemove(speedY, index);
+	swapRemove(size, index);
+	swapRemove(rotationSpeed, index);
+	swapRemove(color, index);
+	swapRemove(meshIndex, index);
+	swapRemove(prevPosX, index);
+	swapRemove(prevPosY, index);
+	swapRemove(prevRotation, index);
+}
+
+void EntityArrays::reserve(uint32_t count)
+{
+	slots.reserve(count);
+	posX.reserve(count);
+	posY.reserve(count);
+	posZ.reserve(count);
+	rotation.reserve(count);
+	speedX.reserve(count);
+	speedY.reserve(count);
+	size.reserve(count);
+	rotationSpeed.reserve(count);
+	color.reserve(count);
+	meshIndex.reserve(count);
+	prevPosX.reserve(count);
+	prevPosY.reserve(count);
+	prevRotation.reserve(count);
+}
+
+Entity EntityArrays::get(uint32_t index) const
+{
+	return Entity{ .posX = posX[index], .posY = posY[index], .posZ = posZ[index], .rotation = rotation[index],
+		.speedX = speedX[index], .speedY = speedY[index], .size = size[index], .rotationSpeed = rotationSpeed[index] };
+}
+
+void EntityArrays::set(uint32_t index, const Entity &entity)
+{
+	posX[index] = entity.posX;
+	posY[index] = entity.posY;
+	posZ[index] = entity.posZ;
+	rotation[index] = entity.rotation;
+	speedX[index] = entity.speedX;
+	speedY[index] = entity.speedY;
+	size[index] = entity.size;
+	rotationSpeed[index] = entity.rotationSpeed;
+}
+
+void integrateEntities(EntityArrays &entities, uint32_t startIndex, uint32_t count, float stepDt, uint32_t stepCount,
+	float wrapWidth, float wrapHeight)
+{
+	float *posX = entities.posX.data();
+	float *posY = entities.posY.data();
+	float *rotation = entities.rotation.data();
+	float *prevPosX = entities.prevPosX.data();
+	float *prevPosY = entities.prevPosY.data();
+	float *prevRotation = entities.prevRotation.data();
+	const float *speedX = entities.speedX.data();
+	const float *speedY = entities.speedY.data();
+	const float *rotationSpeed = entities.rotationSpeed.data();
+
+	// No steps keeps the previous state too, render keeps interpolating between the same states.
+	if(stepCount == 0u)
+		return;
+
+	// Branchless so the compiler can vectorize it, assumes entity moves less than wrap size per step.
+	for(uint32_t i = startIndex; i < startIndex + count; ++i)
+	{
+		float x = posX[ i ];
+		float y = posY[ i ];
+		float rot = rotation[ i ];
+		float px = x;
+		float py = y;
+		float prot = rot;
+		for(uint32_t step = 0; step < stepCount; ++step)
+		{
+			px = x;
+			py = y;
+			prot = rot;
+
+			x = x + speedX[ i ] * stepDt;
+			y = y + speedY[ i ] * stepDt;
+			x = x >= wrapWidth ? x - wrapWidth : x;
+			x = x < 0.0f ? x + wrapWidth : x;
+			y = y >= wrapHeight ? y - wrapHeight : y;
+			y = y < 0.0f ? y + wrapHeight : y;
+
+			rot = rot + rotationSpeed[ i ] * stepDt;
+			// Keep rotation small, so sin / cos stay accurate.
+			rot = rot > float(M_PI) ? rot - float(2.0 * M_PI) : rot;
+			rot = rot < -float(M_PI) ? rot + float(2.0 * M_PI) : rot;
+		}
+
+		posX[ i ] = x;
+		posY[ i ] = y;
+		rotation[ i ] = rot;
+		prevPosX[ i ] = px;
+		prevPosY[ i ] = py;
+		prevRotation[ i ] = prot;
+	}
+}
+
+// Moves from prev towards cur the shorter way around, result is wrapped back into [0, wrap).
+static float interpolateWrapped(float prev, float cur, float alpha, float wrap)
+{
+	float d = cur - prev;
+	d = d > wrap * 0.5f ? d - wrap : d;
+	d = d < -wrap * 0.5f ? d + wrap : d;
+	float v = prev + d * alpha;
+	v = v >= wrap ? v - wrap : v;
+	v = v < 0.0f ? v + wrap : v;
+	return v;
+}
+
+static float interpolateAngle(float prev, float cur, float alpha)
+{
+	float d = cur - prev;
+	d = d > float(M_PI) ? d - float(2.0 * M_PI) : d;
+	d = d < -float(M_PI) ? d + float(2.0 * M_PI) : d;
+	return prev + d * alpha;
+}
+
+GpuModelInstance packModelInstance(float posX, float posY, float rotation, float size, 
+	uint32_t color, uint32_t meshIndex)
+{
+	uint32_t pos = uint32_t((posX / 2048.0f) * 65535.0f);
+	pos += uint32_t((posY / 2048.0f) * 65535.0f) << 16u;
+
+	uint32_t sincossize = uint32_t((size / 64.0f) * 1023.0f);
+	float sinv = sinf(rotation);
+	float cosv = cosf(rotation);
+	sincossize += uint32_t((sinv * 0.5f + 0.5f) * 1023.0f) << 10u;
+	sincossize += uint32_t((cosv * 0.5f + 0.5f) * 1023.0f) << 20u;
+
+	return GpuModelInstance{ .pos = pos, .sinCosRotSize = sincossize, .color = color, 
+		.meshIndex = meshIndex };
+}
+
+GpuModelInstance packModelInstance(const EntityArrays &entities, uint32_t index, const InterpolationParams &params)
+{
+	float x = interpolateWrapped(entities.prevPosX[ index ], entities.posX[ index ], params.alpha, params.wrapWidth);
+	float y = interpolateWrapped(entities.prevPosY[ index ], entities.posY[ index ], params.alpha, params.wrapHeight);
+	float rot = interpolateAngle(entities.prevRotation[ index ], entities.rotation[ index ], params.alpha);
+	return packModelInstance(x, y, rot, entities.size[ index ], entities.color[ index ], entities.meshIndex[ index ]);
+}
+
+void packModelInstancesScalar(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, GpuModelInstance *outInstances)
+{
+	for (uint32_t i = startIndex; i < startIndex + count; ++i)
+	{
+		// Write every member, output can be mapped write combined memory.
+		outInstances[ i ] = packModelInstance(entities, i, params);
+	}
+}
+
+// Sincos approximation: reduce into [-pi/4, pi/4] around multiple of pi/2 with cephes
+// constants, then pick and negate the sin / cos polynomials by quadrant.
+static constexpr float TwoOverPi = 0.636619772367581343f;
+static constexpr float HalfPi1 = 1.5703125f;
+static constexpr float HalfPi2 = 4.837512969970703125e-4f;
+static constexpr float HalfPi3 = 7.54978995489188216e-8f;
+
+static constexpr float SinC0 = -1.6666654611e-1f;
+static constexpr float SinC1 = 8.3321608736e-3f;
+static constexpr float SinC2 = -1.9515295891e-4f;
+
+static constexpr float CosC0 = 4.166664568298827e-2f;
+static constexpr float CosC1 = -1.388731625493765e-3f;
+static constexpr float CosC2 = 2.443315711809948e-5f;
+
+#if ENTITIES_USE_AVX2
+
+static void sinCos8(__m256 x, __m256 &outSin, __m256 &outCos)
+{
+	__m256 j = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(TwoOverPi)),
+		_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256i q = _mm256_cvtps_epi32(j);
+
+	__m256 r = _mm256_fnmadd_ps(j, _mm256_set1_ps(HalfPi1), x);
+	r = _mm256_fnmadd_ps(j, _mm256_set1_ps(HalfPi2), r);
+	r = _mm256_fnmadd_ps(j, _mm256_set1_ps(HalfPi3), r);
+	__m256 r2 = _mm256_mul_ps(r, r);
+
+	__m256 s = _mm256_fmadd_ps(r2, _mm256_set1_ps(SinC2), _mm256_set1_ps(SinC1));
+	s = _mm256_fmadd_ps(r2, s, _mm256_set1_ps(SinC0));
+	s = _mm256_fmadd_ps(_mm256_mul_ps(r2, r), s, r);
+
+	__m256 c = _mm256_fmadd_ps(r2, _mm256_set1_ps(CosC2), _mm256_set1_ps(CosC1));
+	c = _mm256_fmadd_ps(r2, c, _mm256_set1_ps(CosC0));
+	c = _mm256_mul_ps(_mm256_mul_ps(r2, r2), c);
+	c = _mm256_fnmadd_ps(r2, _mm256_set1_ps(0.5f), c);
+	c = _mm256_add_ps(c, _mm256_set1_ps(1.0f));
+
+	__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+		_mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+	__m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30));
+	__m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+		_mm256_and_si256(_mm256_add_epi32(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+
+	outSin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+	outCos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+}
+
+static __m256 interpolateWrapped8(__m256 prev, __m256 cur, __m256 alpha, __m256 wrap)
+{
+	__m256 halfWrap = _mm256_mul_ps(wrap, _mm256_set1_ps(0.5f));
+	__m256 zero = _mm256_setzero_ps();
+	__m256 d = _mm256_sub_ps(cur, prev);
+	d = _mm256_sub_ps(d, _mm256_and_ps(_mm256_cmp_ps(d, halfWrap, _CMP_GT_OQ), wrap));
+	d = _mm256_add_ps(d, _mm256_and_ps(_mm256_cmp_ps(d, _mm256_sub_ps(zero, halfWrap), _CMP_LT_OQ), wrap));
+	__m256 v = _mm256_add_ps(prev, _mm256_mul_ps(d, alpha));
+	v = _mm256_sub_ps(v, _mm256_and_ps(_mm256_cmp_ps(v, wrap, _CMP_GE_OQ), wrap));
+	v = _mm256_add_ps(v, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_LT_OQ), wrap));
+	return v;
+}
+
+static uint32_t packSimd(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, GpuModelInstance *outInstances)
+{
+	const __m256 alpha = _mm256_set1_ps(params.alpha);
+	const __m256 wrapWidth = _mm256_set1_ps(params.wrapWidth);
+	const __m256 wrapHeight = _mm256_set1_ps(params.wrapHeight);
+	const __m256 pi = _mm256_set1_ps(float(M_PI));
+	const __m256 twoPi = _mm256_set1_ps(float(2.0 * M_PI));
+	const __m256 posScale = _mm256_set1_ps(65535.0f);
+	const __m256 posDiv = _mm256_set1_ps(1.0f / 2048.0f);
+	const __m256 sizeDiv = _mm256_set1_ps(1.0f / 64.0f);
+	const __m256 quant10 = _mm256_set1_ps(1023.0f);
+	const __m256 half = _mm256_set1_ps(0.5f);
+
+	uint32_t i = startIndex;
+	for(; i + 8u <= startIndex + count; i += 8u)
+	{
+		__m256 x = interpolateWrapped8(_mm256_loadu_ps(entities.prevPosX.data() + i),
+			_mm256_loadu_ps(entities.posX.data() + i), alpha, wrapWidth);
+		__m256 y = interpolateWrapped8(_mm256_loadu_ps(entities.prevPosY.data() + i),
+			_mm256_loadu_ps(entities.posY.data() + i), alpha, wrapHeight);
+		__m256 sz = _mm256_loadu_ps(entities.size.data() + i);
+
+		__m256 prevRot = _mm256_loadu_ps(entities.prevRotation.data() + i);
+		__m256 dRot = _mm256_sub_ps(_mm256_loadu_ps(entities.rotation.data() + i), prevRot);
+		dRot = _mm256_sub_ps(dRot, _mm256_and_ps(_mm256_cmp_ps(dRot, pi, _CMP_GT_OQ), twoPi));
+		dRot = _mm256_add_ps(dRot, _mm256_and_ps(_mm256_cmp_ps(dRot, _mm256_sub_ps(_mm256_setzero_ps(), pi), _CMP_LT_OQ), twoPi));
+		__m256 rot = _mm256_add_ps(prevRot, _mm256_mul_ps(dRot, alpha));
+
+		// Dividing with power of 2 is exact, so multiplying with reciprocal gives same bits as scalar path.
+		__m256i px = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(x, posDiv), posScale));
+		__m256i py = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(y, posDiv), posScale));
+		__m256i pos = _mm256_add_epi32(px, _mm256_slli_epi32(py, 16));
+
+		__m256 sinv, cosv;
+		sinCos8(rot, sinv, cosv);
+		__m256i qs = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(sz, sizeDiv), quant10));
+		__m256i qsin = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sinv, half), half), quant10));
+		__m256i qcos = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cosv, half), half), quant10));
+		__m256i sinCosSize = _mm256_add_epi32(qs,
+			_mm256_add_epi32(_mm256_slli_epi32(qsin, 10), _mm256_slli_epi32(qcos, 20)));
+
+		__m256i color = _mm256_loadu_si256((const __m256i *)(entities.color.data() + i));
+		__m256i mesh = _mm256_loadu_si256((const __m256i *)(entities.meshIndex.data() + i));
+
+		// 4x4 transpose of 32 bit lanes into the instance layout, each 128 bit half holds 4 instances.
+		__m256i t0 = _mm256_unpacklo_epi32(pos, sinCosSize);
+		__m256i t1 = _mm256_unpacklo_epi32(color, mesh);
+		__m256i t2 = _mm256_unpackhi_epi32(pos, sinCosSize);
+		__m256i t3 = _mm256_unpackhi_epi32(color, mesh);
+
+		__m256i o0 = _mm256_unpacklo_epi64(t0, t1);
+		__m256i o1 = _mm256_unpackhi_epi64(t0, t1);
+		__m256i o2 = _mm256_unpacklo_epi64(t2, t3);
+		__m256i o3 = _mm256_unpackhi_epi64(t2, t3);
+
+		__m256i *out = (__m256i *)(outInstances + i);
+		_mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(o0, o1, 0x20));
+		_mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(o2, o3, 0x20));
+		_mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(o0, o1, 0x31));
+		_mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(o2, o3, 0x31));
+	}
+	return i;
+}
+
+#elif ENTITIES_USE_SSE2
+
+static __m128 select4(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+static void sinCos4(__m128 x, __m128 &outSin, __m128 &outCos)
+{
+	// No round instruction in SSE2, cvtps rounds to nearest with default rounding mode.
+	__m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TwoOverPi)));
+	__m128 j = _mm_cvtepi32_ps(q);
+
+	__m128 r = _mm_sub_ps(x, _mm_mul_ps(j, _mm_set1_ps(HalfPi1)));
+	r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(HalfPi2)));
+	r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(HalfPi3)));
+	__m128 r2 = _mm_mul_ps(r, r);
+
+	__m128 s = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(SinC2)), _mm_set1_ps(SinC1));
+	s = _mm_add_ps(_mm_mul_ps(r2, s), _mm_set1_ps(SinC0));
+	s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r2, r), s), r);
+
+	__m128 c = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(CosC2)), _mm_set1_ps(CosC1));
+	c = _mm_add_ps(_mm_mul_ps(r2, c), _mm_set1_ps(CosC0));
+	c = _mm_mul_ps(_mm_mul_ps(r2, r2), c);
+	c = _mm_sub_ps(c, _mm_mul_ps(r2, _mm_set1_ps(0.5f)));
+	c = _mm_add_ps(c, _mm_set1_ps(1.0f));
+
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+	__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+		_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+	outSin = _mm_xor_ps(select4(swap, s, c), sinSign);
+	outCos = _mm_xor_ps(select4(swap, c, s), cosSign);
+}
+
+static __m128 interpolateWrapped4(__m128 prev, __m128 cur, __m128 alpha, __m128 wrap)
+{
+	__m128 halfWrap = _mm_mul_ps(wrap, _mm_set1_ps(0.5f));
+	__m128 zero = _mm_setzero_ps();
+	__m128 d = _mm_sub_ps(cur, prev);
+	d = _mm_sub_ps(d, _mm_and_ps(_mm_cmpgt_ps(d, halfWrap), wrap));
+	d = _mm_add_ps(d, _mm_and_ps(_mm_cmplt_ps(d, _mm_sub_ps(zero, halfWrap)), wrap));
+	__m128 v = _mm_add_ps(prev, _mm_mul_ps(d, alpha));
+	v = _mm_sub_ps(v, _mm_and_ps(_mm_cmpge_ps(v, wrap), wrap));
+	v = _mm_add_ps(v, _mm_and_ps(_mm_cmplt_ps(v, zero), wrap));
+	return v;
+}
+
+static uint32_t packSimd(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, GpuModelInstance *outInstances)
+{
+	const __m128 alpha = _mm_set1_ps(params.alpha);
+	const __m128 wrapWidth = _mm_set1_ps(params.wrapWidth);
+	const __m128 wrapHeight = _mm_set1_ps(params.wrapHeight);
+	const __m128 pi = _mm_set1_ps(float(M_PI));
+	const __m128 twoPi = _mm_set1_ps(float(2.0 * M_PI));
+	const __m128 posScale = _mm_set1_ps(65535.0f);
+	const __m128 posDiv = _mm_set1_ps(1.0f / 2048.0f);
+	const __m128 sizeDiv = _mm_set1_ps(1.0f / 64.0f);
+	const __m128 quant10 = _mm_set1_ps(1023.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	uint32_t i = startIndex;
+	for(; i + 4u <= startIndex + count; i += 4u)
+	{
+		__m128 x = interpolateWrapped4(_mm_loadu_ps(entities.prevPosX.data() + i),
+			_mm_loadu_ps(entities.posX.data() + i), alpha, wrapWidth);
+		__m128 y = interpolateWrapped4(_mm_loadu_ps(entities.prevPosY.data() + i),
+			_mm_loadu_ps(entities.posY.data() + i), alpha, wrapHeight);
+		__m128 sz = _mm_loadu_ps(entities.size.data() + i);
+
+		__m128 prevRot = _mm_loadu_ps(entities.prevRotation.data() + i);
+		__m128 dRot = _mm_sub_ps(_mm_loadu_ps(entities.rotation.data() + i), prevRot);
+		dRot = _mm_sub_ps(dRot, _mm_and_ps(_mm_cmpgt_ps(dRot, pi), twoPi));
+		dRot = _mm_add_ps(dRot, _mm_and_ps(_mm_cmplt_ps(dRot, _mm_sub_ps(_mm_setzero_ps(), pi)), twoPi));
+		__m128 rot = _mm_add_ps(prevRot, _mm_mul_ps(dRot, alpha));
+
+		// Dividing with power of 2 is exact, so multiplying with reciprocal gives same bits as scalar path.
+		__m128i px = _mm_cvttps_epi32(_mm_mul_ps(_mm_mul_ps(x, posDiv), posScale));
+		__m128i py = _mm_cvttps_epi32(_mm_mul_ps(_mm_mul_ps(y, posDiv), posScale));
+		__m128i pos = _mm_add_epi32(px, _mm_slli_epi32(py, 16));
+
+		__m128 sinv, cosv;
+		sinCos4(rot, sinv, cosv);
+		__m128i qs = _mm_cvttps_epi32(_mm_mul_ps(_mm_mul_ps(sz, sizeDiv), quant10));
+		__m128i qsin = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(sinv, half), half), quant10));
+		__m128i qcos = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(cosv, half), half), quant10));
+		__m128i sinCosSize = _mm_add_epi32(qs, _mm_add_epi32(_mm_slli_epi32(qsin, 10), _mm_slli_epi32(qcos, 20)));
+
+		__m128i color = _mm_loadu_si128((const __m128i *)(entities.color.data() + i));
+		__m128i mesh = _mm_loadu_si128((const __m128i *)(entities.meshIndex.data() + i));
+
+		// 4x4 transpose of 32 bit lanes into the instance layout.
+		__m128i t0 = _mm_unpacklo_epi32(pos, sinCosSize);
+		__m128i t1 = _mm_unpacklo_epi32(color, mesh);
+		__m128i t2 = _mm_unpackhi_epi32(pos, sinCosSize);
+		__m128i t3 = _mm_unpackhi_epi32(color, mesh);
+
+		__m128i *out = (__m128i *)(outInstances + i);
+		_mm_storeu_si128(out + 0, _mm_unpacklo_epi64(t0, t1));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi64(t0, t1));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi64(t2, t3));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi64(t2, t3));
+	}
+	return i;
+}
+
+#endif
+
+void packModelInstances(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, GpuModelInstance *outInstances)
+{
+#if ENTITIES_USE_AVX2 || ENTITIES_USE_SSE2
+	uint32_t i = packSimd(entities, startIndex, count, params, outInstances);
+	// Tail
+	packModelInstancesScalar(entities, i, startIndex + count - i, params, outInstances);
+#else
+	packModelInstancesScalar(entities, startIndex, count, params, outInstances);
+#endif
+}
+
+void bucketModelInstancesByLod(const EntityArrays &entities, const uint32_t *entityIndices, uint32_t indexCount,
+	float pixelsPerUnit, const GpuModelInstance *packedInstances, MeshInstanceBuckets &buckets,
+	GpuModelInstance *outInstances)
+{
+	static constexpr uint32_t MaxBucketMeshes = 256u;
+	assert(buckets.meshCount <= MaxBucketMeshes && "Too many meshes for lod buckets");
+
+	uint32_t counts[ MaxBucketMeshes ] = {};
+	for(uint32_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t entity = entityIndices[ i ];
+		uint32_t mesh = entities.meshIndex[ entity ] + selectAsteroidLod(entities.size[ entity ], pixelsPerUnit);
+		++counts[ mesh ];
+	}
+
+	// Counts turn into write cursors.
+	for(uint32_t mesh = 0; mesh < buckets.meshCount; ++mesh)
+	{
+		if(counts[ mesh ] > 0u)
+			counts[ mesh ] = buckets.baseInstances[ mesh ] + buckets.instanceCounts[ mesh ].fetch_add(counts[ mesh ]);
+	}
+
+	for(uint32_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t entity = entityIndices[ i ];
+		uint32_t mesh = entities.meshIndex[ entity ] + selectAsteroidLod(entities.size[ entity ], pixelsPerUnit);
+		outInstances[ counts[ mesh ]++ ] = packedInstances[ entity ];
+	}
+}
+
+static uint32_t cullEntitiesScalar(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, const CullRect &rect, uint32_t *outVisibleIndices)
+{
+	uint32_t visibleCount = 0u;
+	for(uint32_t i = startIndex; i < startIndex + count; ++i)
+	{
+		float x = interpolateWrapped(entities.prevPosX[ i ], entities.posX[ i ], params.alpha, params.wrapWidth);
+		float y = interpolateWrapped(entities.prevPosY[ i ], entities.posY[ i ], params.alpha, params.wrapHeight);
+		float r = entities.size[ i ];
+		bool visible = x + r >= rect.minX && x - r <= rect.maxX && y + r >= rect.minY && y - r <= rect.maxY;
+		// Always write, only advance for visible ones, so there is no branch to mispredict.
+		outVisibleIndices[ visibleCount ] = i;
+		visibleCount += visible ? 1u : 0u;
+	}
+	return visibleCount;
+}
+
+uint32_t cullEntities(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, const CullRect &rect, uint32_t *outVisibleIndices)
+{
+	uint32_t i = startIndex;
+	uint32_t visibleCount = 0u;
+#if ENTITIES_USE_AVX2
+	const __m256 alpha = _mm256_set1_ps(params.alpha);
+	const __m256 wrapWidth = _mm256_set1_ps(params.wrapWidth);
+	const __m256 wrapHeight = _mm256_set1_ps(params.wrapHeight);
+	const __m256 minX = _mm256_set1_ps(rect.minX);
+	const __m256 minY = _mm256_set1_ps(rect.minY);
+	const __m256 maxX = _mm256_set1_ps(rect.maxX);
+	const __m256 maxY = _mm256_set1_ps(rect.maxY);
+	for(; i + 8u <= startIndex + count; i += 8u)
+	{
+		__m256 x = interpolateWrapped8(_mm256_loadu_ps(entities.prevPosX.data() + i),
+			_mm256_loadu_ps(entities.posX.data() + i), alpha, wrapWidth);
+		__m256 y = interpolateWrapped8(_mm256_loadu_ps(entities.prevPosY.data() + i),
+			_mm256_loadu_ps(entities.posY.data() + i), alpha, wrapHeight);
+		__m256 r = _mm256_loadu_ps(entities.size.data() + i);
+
+		__m256 inside = _mm256_and_ps(
+			_mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(x, r), minX, _CMP_GE_OQ),
+				_mm256_cmp_ps(_mm256_sub_ps(x, r), maxX, _CMP_LE_OQ)),
+			_mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(y, r), minY, _CMP_GE_OQ),
+				_mm256_cmp_ps(_mm256_sub_ps(y, r), maxY, _CMP_LE_OQ)));
+		uint32_t mask = uint32_t(_mm256_movemask_ps(inside));
+
+		// Compact the survivors, write every lane and only advance for the visible ones.
+		for(uint32_t lane = 0; lane < 8u; ++lane)
+		{
+			outVisibleIndices[ visibleCount ] = i + lane;
+			visibleCount += (mask >> lane) & 1u;
+		}
+	}
+#elif ENTITIES_USE_SSE2
+	const __m128 alpha = _mm_set1_ps(params.alpha);
+	const __m128 wrapWidth = _mm_set1_ps(params.wrapWidth);
+	const __m128 wrapHeight = _mm_set1_ps(params.wrapHeight);
+	const __m128 minX = _mm_set1_ps(rect.minX);
+	const __m128 minY = _mm_set1_ps(rect.minY);
+	const __m128 maxX = _mm_set1_ps(rect.maxX);
+	const __m128 maxY = _mm_set1_ps(rect.maxY);
+	for(; i + 4u <= startIndex + count; i += 4u)
+	{
+		__m128 x = interpolateWrapped4(_mm_loadu_ps(entities.prevPosX.data() + i),
+			_mm_loadu_ps(entities.posX.data() + i), alpha, wrapWidth);
+		__m128 y = interpolateWrapped4(_mm_loadu_ps(entities.prevPosY.data() + i),
+			_mm_loadu_ps(entities.posY.data() + i), alpha, wrapHeight);
+		__m128 r = _mm_loadu_ps(entities.size.data() + i);
+
+		__m128 inside = _mm_and_ps(
+			_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(x, r), minX), _mm_cmple_ps(_mm_sub_ps(x, r), maxX)),
+			_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(y, r), minY), _mm_cmple_ps(_mm_sub_ps(y, r), maxY)));
+		uint32_t mask = uint32_t(_mm_movemask_ps(inside));
+
+		// Compact the survivors, write every lane and only advance for the visible ones.
+		for(uint32_t lane = 0; lane < 4u; ++lane)
+		{
+			outVisibleIndices[ visibleCount ] = i + lane;
+			visibleCount += (mask >> lane) & 1u;
+		}
+	}
+#endif
+	// Tail
+	visibleCount += cullEntitiesScalar(entities, i, startIndex + count - i, params, rect,
+		outVisibleIndices + visibleCount);
+	return visibleCount;
+}
+
+uint32_t updateModelBatch(EntityArrays &entities, uint32_t startIndex, uint32_t endIndex,
+	const ModelFrameParams &params)
+{
+	uint32_t count = endIndex - startIndex;
+	integrateEntities(entities, startIndex, count, params.stepDt, params.stepCount, params.wrapWidth,
+		params.wrapHeight);
+	uint32_t visibleCount = cullEntities(entities, startIndex, count, params.interpolation, params.cullRect,
+		params.visibleIndices + startIndex);
+	packModelInstances(entities, startIndex, count, params.interpolation, params.packedInstances);
+	bucketModelInstancesByLod(entities, params.visibleIndices + startIndex, visibleCount, params.pixelsPerUnit,
+		params.packedInstances, *params.buckets, params.outInstances);
+	return visibleCount;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "core/slotmap.h"
+
+struct Entity
+{
+	float posX;
+	float posY;
+	float posZ;
+	float rotation;
+
+	float speedX;
+	float speedY;
+	float size;
+	float rotationSpeed;
+};
+
+struct GpuModelInstance
+{
+	uint32_t pos;
+	uint32_t sinCosRotSize;
+	uint32_t color;
+	uint32_t meshIndex;
+};
+
+// Structure of arrays storage for the entities, so the per frame loops can run 4 / 8 entities at a time.
+// Arrays stay packed, removing moves the last entity into the hole, so keep handles instead of indices
+// to entities that have to be found again later.
+struct EntityArrays
+{
+	core::SlotHandle add(const Entity &entity, uint32_t color, uint32_t meshIndex);
+	// Returns false for stale handles.
+	bool remove(core::SlotHandle handle);
+	void removeAt(uint32_t index);
+	void reserve(uint32_t count);
+	// core::SlotMap::InvalidIndex for stale handles.
+	uint32_t getIndex(core::SlotHandle handle) const { return slots.getIndex(handle); }
+	Entity get(uint32_t index) const;
+	void set(uint32_t index, const Entity &entity);
+	uint32_t getCount() const { return uint32_t(posX.size()); }
+
+	core::SlotMap slots;
+
+	std::vector<float> posX;
+	std::vector<float> posY;
+	std::vector<float> posZ;
+	std::vector<float> rotation;
+
+	std::vector<float> speedX;
+	std::vector<float> speedY;
+	std::vector<float> size;
+	std::vector<float> rotationSpeed;
+
+	std::vector<uint32_t> color;
+	std::vector<uint32_t> meshIndex;
+
+	// State before the last simulation step, rendering interpolates from it towards the current state.
+	std::vector<float> prevPosX;
+	std::vector<float> prevPosY;
+	std::vector<float> prevRotation;
+};
+
+// Runs stepCount fixed steps for entities [startIndex, startIndex + count), moving and rotating them by their
+// speeds and wrapping position into [0, wrapWidth) x [0, wrapHeight). The state before the last step is saved
+// into the prev arrays. Every entity is independent so ranges can run on separate threads.
+void integrateEntities(EntityArrays &entities, uint32_t startIndex, uint32_t count, float stepDt, uint32_t stepCount,
+	float wrapWidth, float wrapHeight);
+
+// Interpolates from prev towards current state by alpha, taking the shorter way around the wrap.
+struct InterpolationParams
+{
+	float alpha = 1.0f;
+	float wrapWidth = 0.0f;
+	float wrapHeight = 0.0f;
+};
+
+// Packs interpolated entities [startIndex, startIndex + count) into outInstances[startIndex...]. Position is
+// quantized into 16 bits per axis, size, sin and cos of rotation into 10 bits each.
+// Uses AVX2 when compiled with it, SSE2 on x64, otherwise falls back to packModelInstancesScalar.
+// Sin and cos use polynomial approximation, so they can differ by one quantization step from the scalar path.
+void packModelInstances(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, GpuModelInstance *outInstances);
+
+GpuModelInstance packModelInstance(float posX, float posY, float rotation, float size, 
+	uint32_t color, uint32_t meshIndex);
+GpuModelInstance packModelInstance(const EntityArrays &entities, uint32_t index, const InterpolationParams &params);
+
+// Reference implementation with sinf / cosf.
+void packModelInstancesScalar(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, GpuModelInstance *outInstances);
+
+// Asteroid meshes come in LOD chains of AsteroidLodCount meshes, every LOD has half the corners of the previous one.
+static constexpr uint32_t AsteroidLodCount = 4u;
+// Smallest on screen diameter in pixels for each LOD, asteroids.comp uses the same values.
+static constexpr float AsteroidLodMinPixels[ AsteroidLodCount ] = { 24.0f, 12.0f, 6.0f, 0.0f };
+
+// LOD 0 is the most detailed. Counts the thresholds the projected diameter is below, so no branches.
+inline uint32_t selectAsteroidLod(float radius, float pixelsPerUnit)
+{
+	float diameter = radius * 2.0f * pixelsPerUnit;
+	uint32_t lod = 0u;
+	for(uint32_t i = 0; i < AsteroidLodCount; ++i)
+		lod += diameter < AsteroidLodMinPixels[ i ] ? 1u : 0u;
+	return lod;
+}
+
+// Instance ranges for meshes, entity with meshIndex m and lod l goes into range of mesh m + l.
+struct MeshInstanceBuckets
+{
+	const uint32_t *baseInstances = nullptr;
+	// Incremented by the writers, reset before the frame.
+	std::atomic<uint32_t> *instanceCounts = nullptr;
+	uint32_t meshCount = 0u;
+};
+
+// Scatters already packed entities listed in entityIndices from packedInstances[entityIndex] into the range of
+// their LOD mesh. Every call reserves its slots with one atomic add per mesh, so lists can run on separate
+// threads, the order inside a mesh range depends on thread timing.
+void bucketModelInstancesByLod(const EntityArrays &entities, const uint32_t *entityIndices, uint32_t indexCount,
+	float pixelsPerUnit, const GpuModelInstance *packedInstances, MeshInstanceBuckets &buckets,
+	GpuModelInstance *outInstances);
+
+struct CullRect
+{
+	float minX;
+	float minY;
+	float maxX;
+	float maxY;
+};
+
+// Tests bounding circles of interpolated entities [startIndex, startIndex + count) against rect and writes
+// indices of the overlapping ones into outVisibleIndices, returns how many were written. Size is the radius.
+// Same interpolation and wrapping as packModelInstances, so the test sees the position that gets drawn.
+uint32_t cullEntities(const EntityArrays &entities, uint32_t startIndex, uint32_t count,
+	const InterpolationParams &params, const CullRect &rect, uint32_t *outVisibleIndices);
+
+// Same for every batch of a frame of updateModelBatch.
+struct ModelFrameParams
+{
+	float stepDt = 0.0f;
+	uint32_t stepCount = 0u;
+	float wrapWidth = 0.0f;
+	float wrapHeight = 0.0f;
+	InterpolationParams interpolation;
+	CullRect cullRect{};
+	float pixelsPerUnit = 1.0f;
+
+	// Entity count long scratch arrays, every batch only touches its own range.
+	uint32_t *visibleIndices = nullptr;
+	GpuModelInstance *packedInstances = nullptr;
+	MeshInstanceBuckets *buckets = nullptr;
+	GpuModelInstance *outInstances = nullptr;
+};
+
+// Cpu model frame for entities [startIndex, endIndex): fixed steps, culling, packing and LOD bucketing.
+// Batches only share the bucket counters, so ranges can run on separate threads. Start of every batch
+// except the last one has to be multiple of 8, so simd code sees the same groups as in a single batch.
+// Returns the visible count of the batch.
+uint32_t updateModelBatch(EntityArrays &entities, uint32_t startIndex, uint32_t endIndex,
+	const ModelFrameParams &params);
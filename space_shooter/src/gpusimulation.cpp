@@ -0,0 +1,113 @@
+#include "gpusimulation.h"
+
+#include "glad/glad.h"
+
+#include <cstdio>
+#include <vector>
+
+// Matches EntityState in asteroids.comp, vec2 members first to keep std430 layout without padding.
+struct GpuEntityState
+{
+	float posX;
+	float posY;
+	float speedX;
+	float speedY;
+	float prevPosX;
+	float prevPosY;
+
+	float rotation;
+	float rotationSpeed;
+	float prevRotation;
+	float size;
+	uint32_t color;
+	uint32_t meshIndex;
+};
+
+static std::vector<GpuEntityState> getEntityStates(const EntityArrays &entities, uint32_t count)
+{
+	std::vector<GpuEntityState> states(count);
+	for(uint32_t i = 0; i < count; ++i)
+	{
+		states[ i ] = GpuEntityState{ .posX = entities.posX[ i ], .posY = entities.posY[ i ],
+			.speedX = entities.speedX[ i ], .speedY = entities.speedY[ i ],
+			.prevPosX = entities.prevPosX[ i ], .prevPosY = entities.prevPosY[ i ],
+			.rotation = entities.rotation[ i ], .rotationSpeed = entities.rotationSpeed[ i ],
+			.prevRotation = entities.prevRotation[ i ], .size = entities.size[ i ], 
+			.color = entities.color[ i ], .meshIndex = entities.meshIndex[ i ] };
+	}
+	return states;
+}
+
+// Ssbo size has to be multiple of 16 bytes.
+static uint32_t getDrawBufferSize(uint32_t drawCount)
+{
+	return (drawCount * uint32_t(sizeof(DrawElementsIndirectCommand)) + 15u) & ~15u;
+}
+
+GpuAsteroidSimulation::GpuAsteroidSimulation(const EntityArrays &entities, uint32_t asteroidCount,
+	const std::vector<DrawElementsIndirectCommand> &asteroidDraws, uint32_t instanceCount) :
+	entityStateBuffer(GL_SHADER_STORAGE_BUFFER, asteroidCount * uint32_t(sizeof(GpuEntityState)), 0,
+		getEntityStates(entities, asteroidCount).data(), true),
+	instanceBuffer(GL_SHADER_STORAGE_BUFFER, instanceCount * uint32_t(sizeof(GpuModelInstance)), 
+		GL_DYNAMIC_STORAGE_BIT, nullptr, true),
+	drawCommandBuffer(GL_DRAW_INDIRECT_BUFFER, getDrawBufferSize(uint32_t(asteroidDraws.size())),
+		GL_DYNAMIC_STORAGE_BIT, nullptr, true)
+{
+	this->asteroidCount = asteroidCount;
+	this->asteroidMeshCount = uint32_t(asteroidDraws.size());
+
+	// Zero count padding commands at the end are never drawn.
+	emptyDraws.resize(getDrawBufferSize(asteroidMeshCount) / sizeof(DrawElementsIndirectCommand) + 1u);
+	for(uint32_t i = 0; i < asteroidMeshCount; ++i)
+	{
+		emptyDraws[ i ] = asteroidDraws[ i ];
+		emptyDraws[ i ].instanceCount = 0u;
+	}
+}
+
+bool GpuAsteroidSimulation::init()
+{
+	if(!computeShader.initComputeShader("assets/shaders/asteroids.comp"))
+	{
+		printf("Failed to init asteroid compute shader\n");
+		return false;
+	}
+	return true;
+}
+
+void GpuAsteroidSimulation::update(RenderCommandBuffer &commands, float stepDt, uint32_t stepCount, float alpha,
+	float pixelsPerUnit, float windowWidth, float windowHeight, float worldWidth, float worldHeight)
+{
+	// Reset instance counts, rest of the commands stay the same.
+	drawCommandBuffer.updateBuffer(0u, drawCommandBuffer.size, emptyDraws.data());
+
+	commands.setProgram(computeShader);
+	commands.setUniform2f(0, windowWidth, windowHeight);
+	commands.setUniform2f(1, worldWidth, worldHeight);
+	commands.setUniform1f(2, stepDt);
+	commands.setUniform1ui(3, asteroidCount);
+	commands.setUniform1ui(4, stepCount);
+	commands.setUniform1f(5, alpha);
+	commands.setUniform1f(6, pixelsPerUnit);
+	static_assert(AsteroidLodCount == 4u, "asteroids.comp selects lod from vec4 of thresholds");
+	commands.setUniform4f(7, AsteroidLodMinPixels);
+
+	commands.bindStorage(0, entityStateBuffer);
+	commands.bindStorage(2, instanceBuffer);
+	// Draw command is read as ssbo here and as indirect buffer when drawing.
+	commands.bindStorage(3, drawCommandBuffer.handle);
+
+	commands.dispatchCompute((asteroidCount + 63u) / 64u, 1u, 1u);
+	commands.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void GpuAsteroidSimulation::updateInstances(uint32_t first, uint32_t count, const GpuModelInstance *instances)
+{
+	instanceBuffer.updateBuffer(first * uint32_t(sizeof(GpuModelInstance)), count * uint32_t(sizeof(GpuModelInstance)),
+		(void *)instances);
+}
+
+void GpuAsteroidSimulation::drawAsteroids(RenderCommandBuffer &commands, const MeshRegistry &meshes)
+{
+	meshes.drawIndirect(commands, drawCommandBuffer.handle, 0u, asteroidMeshCount);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "entities.h"
+#include "ogl/meshregistry.h"
+#include "ogl/rendercommandbuffer.h"
+#include "ogl/shader.h"
+#include "ogl/shaderbuffer.h"
+
+// Asteroid state lives on gpu. Compute shader moves them, culls them against the window, picks LOD from the
+// projected size and compacts the visible ones into the start of their LOD mesh's instance range, counting
+// them into the mesh's indirect draw command.
+// Asteroid meshes have to be meshes [0, asteroidDraws.size()) in the registry, since meshIndex + lod picks the command.
+class GpuAsteroidSimulation
+{
+public:
+	// asteroidDraws has draw per asteroid LOD mesh, instanceCount is the capacity of its instance range.
+	GpuAsteroidSimulation(const EntityArrays &entities, uint32_t asteroidCount,
+		const std::vector<DrawElementsIndirectCommand> &asteroidDraws, uint32_t instanceCount);
+
+	bool init();
+	// Records stepCount fixed steps, then culling and packing the state interpolated by alpha from the previous step.
+	void update(RenderCommandBuffer &commands, float stepDt, uint32_t stepCount, float alpha, float pixelsPerUnit,
+		float windowWidth, float windowHeight, float worldWidth, float worldHeight);
+	// Instances after the asteroids, like the player and projectiles, are still written from cpu.
+	void updateInstances(uint32_t first, uint32_t count, const GpuModelInstance *instances);
+	// Expects model shader and mesh registry to be bound.
+	void drawAsteroids(RenderCommandBuffer &commands, const MeshRegistry &meshes);
+
+	ShaderBuffer entityStateBuffer;
+	ShaderBuffer instanceBuffer;
+	ShaderBuffer drawCommandBuffer;
+
+private:
+	Shader computeShader;
+	uint32_t asteroidCount = 0u;
+	uint32_t asteroidMeshCount = 0u;
+	std::vector<DrawElementsIndirectCommand> emptyDraws;
+};
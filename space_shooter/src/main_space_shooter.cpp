@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <stdint.h>
 
 
@@ -7,9 +8,27 @@
 #include <SDL2/SDL.h>
 
 #include "core/app.h"
-
+#include "core/allocationcounter.h"
+#include "core/broadphase.h"
+#include "core/fixedtimestep.h"
+#include "core/fontfile.h"
+#include "core/framearena.h"
+#include "core/jobsystem.h"
+#include "core/renderthread.h"
+#include "core/vfs.h"
+
+#include "entities.h"
+#include "gpusimulation.h"
+
+#include "ogl/fontbuffer.h"
+#include "ogl/glstatecache.h"
+#include "ogl/gputimerpool.h"
+#include "ogl/meshregistry.h"
+#include "ogl/quadbatcher.h"
+#include "ogl/rendercommandbuffer.h"
 #include "ogl/shader.h"
 #include "ogl/shaderbuffer.h"
+#include "ogl/textbuffer.h"
 
 #include <string>
 #include <vector>
@@ -21,33 +40,20 @@
 static constexpr int SCREEN_WIDTH  = 640;
 static constexpr int SCREEN_HEIGHT = 540;
 
+// Asteroids spawn and wrap around inside this area.
+static constexpr float WorldWidth = 2000.0f;
+static constexpr float WorldHeight = 1200.0f;
+// Entity size scales the model, largest model vertex is 1.5 units from the center.
+static constexpr float MaxEntityRadius = 15.0f * 1.5f;
 
-struct Entity
-{
-	float posX;
-	float posY;
-	float posZ;
-	float rotation;
-
-	float speedX;
-	float speedY;
-	float size;
-	float padding;
-};
-
-struct GPUVertexData
-{
-	float posX;
-	float posY;
-	uint16_t pixelSizeX;
-	uint16_t pixelSizeY;
-	uint32_t color;
+// Ship fires a fan of ProjectilesPerStep projectiles every simulation step while space is down.
+static constexpr uint32_t MaxProjectiles = 4096u;
+static constexpr uint32_t ProjectilesPerStep = 5u;
+static constexpr uint32_t ProjectileLifeSteps = 200u;
+static constexpr float ProjectileSpeed = 600.0f;
+static constexpr float ProjectileSize = 2.0f;
 
-	float uvX;
-	float uvY;
 
-	float padding[2];
-};
 
 /*
 
@@ -67,14 +73,6 @@ struct GpuModelInstance
 };
 */
 
-struct GpuModelInstance
-{
-	uint32_t pos;
-	uint32_t sinCosRotSize;
-	uint32_t color;
-	uint32_t modelVertexStartIndex;
-};
-
 struct GpuModelVertex
 {
 	float posX;
@@ -94,49 +92,48 @@ struct Cursor
 	int charHeight = 12;
 };
 
-static void addText(std::string &str, std::vector<GPUVertexData> &vertData, Cursor &cursor)
+struct TextBlocks
 {
-	for(int i = 0; i < int(str.length()); ++i)
-	{
-		GPUVertexData vdata;
-		vdata.color = core::getColor(0.0f, 1.0f, 0, 1.0f);
-		vdata.pixelSizeX = cursor.charWidth;
-		vdata.pixelSizeY = cursor.charHeight;
-		vdata.posX = cursor.xPos;
-		vdata.posY = cursor.yPos;
-
-		uint32_t letter = str[i] - 32;
-
-		vdata.uvX = float(letter) / float(128-32);
-		vdata.uvY = 0.0f;
-
-		vertData.emplace_back(vdata);
+	uint32_t metrics = 0u;
+	uint32_t text = 0u;
+};
 
-		cursor.xPos += cursor.charWidth;
-	}
+// Everything the render thread needs for a frame, the simulation writes straight into it.
+struct FramePacket
+{
+	// Packed player and projectile instances, asteroid ones only from the cpu simulation, and the model draws
+	// with their visible instance counts.
+	std::vector<GpuModelInstance> instances;
+	std::vector<DrawElementsIndirectCommand> modelDraws;
+	uint32_t projectileCount = 0u;
+	// Gpu simulation, the compute update gets recorded from these on the render thread.
+	uint32_t simulationSteps = 0u;
+	float alpha = 0.0f;
+	int windowWidth = 0;
+	int windowHeight = 0;
+
+	// Written by the render thread, readable once beginPacket gives the packet back.
+	float gpuFrameMs = 0.0f;
+	float gpuModelsMs = 0.0f;
+	float gpuUiMs = 0.0f;
+	uint32_t glCalls = 0u;
+	uint32_t skippedGlCalls = 0u;
+};
 
-}
-static void updateText(std::string &str, std::vector<GPUVertexData> &vertData, Cursor &cursor)
+static void updateText(TextBuffer &textBuffer, const TextBlocks &blocks, Cursor &cursor)
 {
-	cursor.xPos = 100.0f;
-	cursor.yPos = 400.0f;
-	std::string tmpStr = "w";
-	tmpStr += std::to_string(cursor.charWidth);
-	tmpStr += ",h";
-	tmpStr += std::to_string(cursor.charHeight);
-	vertData.clear();
-	addText(tmpStr, vertData, cursor);
-
-	cursor.xPos = 100.0f;
-	cursor.yPos = 100.0f;
-	addText(str, vertData, cursor);
-}
+	char tmpStr[32];
+	int tmpLen = snprintf(tmpStr, sizeof(tmpStr), "w%i,h%i", cursor.charWidth, cursor.charHeight);
+	textBuffer.setMetrics(blocks.metrics, 100.0f, 400.0f, cursor.charWidth, cursor.charHeight);
+	textBuffer.setText(blocks.metrics, tmpStr, uint32_t(tmpLen));
 
+	textBuffer.setMetrics(blocks.text, 100.0f, 100.0f, cursor.charWidth, cursor.charHeight);
+}
 
 
 
 
-static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string &filename)
+static void mainProgramLoop(core::App &app, core::FontFile &font, uint32_t fontSize, std::string &filename, bool gpuSimulation)
 {
 	srand(100);
 
@@ -154,183 +151,195 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 		return;
 	}
 
-	std::vector< GpuModelInstance > modelInstances;
-	std::vector< uint32_t > freeModelInstanceIndices;
+	MeshRegistry meshes(uint32_t(sizeof(GpuModelVertex)));
 
-	std::vector< uint32_t > modelIndices;
+	EntityArrays entities;
+	EntityArrays projectiles;
+	// Step index each projectile expires at, kept in the same order as projectiles.
+	std::vector<uint64_t> projectileExpireSteps;
+	projectiles.reserve(MaxProjectiles);
+	projectileExpireSteps.reserve(MaxProjectiles);
 
-	std::vector < GpuModelVertex > vertices;
+	core::JobSystem jobSystem;
+	jobSystem.init();
 
-	modelInstances.reserve(100);
-	
-	std::vector < Entity > entities;
+	core::UniformGrid collisionGrid;
+	std::vector<core::BroadPhasePair> collisionPairs;
 
-	constexpr uint32_t AsteroidMaxTypes = 1000u;
-	for(uint32_t asteroidTypes = 0u; asteroidTypes < AsteroidMaxTypes; ++asteroidTypes)
+	// Asteroids share a handful of shapes, every shape is stored once in the mesh registry as a LOD chain
+	// of AsteroidLodCount meshes. Shape s, lod l is mesh s * AsteroidLodCount + l.
+	static constexpr uint32_t AsteroidShapeCount = 8u;
+	for(uint32_t shape = 0u; shape < AsteroidShapeCount; ++shape)
 	{
 		static constexpr uint32_t AsteroidCorners = 32u;
 
-		float xPos = float(rand()) / float(RAND_MAX) * 2000.0f;
-		float yPos = float(rand()) / float(RAND_MAX) * 1200.0f;
-		float size = 5.0f + 10.0f * float(rand()) / float(RAND_MAX);
-		entities.emplace_back(Entity{ .posX = xPos,  .posY = yPos, .posZ = 0.5f, .rotation = 0.0f, .speedX = 0.0f, .speedY = 0.0f, .size = size, .padding = 0.0f });
+		float radiuses[ AsteroidCorners ];
+		for (uint32_t i = 0; i < AsteroidCorners; ++i)
+			radiuses[ i ] = 0.8f + 0.2f * (float(rand()) / float(RAND_MAX));
 
-/*
-		modelInstances.emplace_back(GpuModelInstance{ .posX = xPos, .posY = yPos, 
-				//.posZ = 0.0f, .rotation = 0.0f, 
-				.sinRotation = 0.0f, .cosRotation = 1.0f,
-				.color = core::getColor(0.5, 0.5, 0.5, 1.0f), .size = size,
-			.modelVertexStartIndex = uint32_t(vertices.size()), .modelIndiceCount = AsteroidCorners });
-*/
-		uint32_t pos = uint32_t((xPos / 2048.0f) * 65535.0f);
-		pos += uint32_t((yPos / 2048.0f) * 65535.0f) << 16u;
-		uint32_t sincossize = uint32_t((size / 64.0f) * 1023.0f);
-		modelInstances.emplace_back(GpuModelInstance{ .pos = pos, 
-				.sinCosRotSize = sincossize,
-				.color = core::getColor(0.5, 0.5, 0.5, 1.0f),
-			.modelVertexStartIndex = uint32_t(vertices.size()) });
+		// Every LOD takes every other corner of the previous one, so the outline stays the same.
+		for(uint32_t lod = 0u; lod < AsteroidLodCount; ++lod)
+		{
+			uint32_t cornerStep = 1u << lod;
+			uint32_t corners = AsteroidCorners / cornerStep;
 
+			std::vector<GpuModelVertex> vertices;
+			std::vector<uint32_t> indices;
+			vertices.emplace_back(GpuModelVertex{ .posX = 0.0f, .posY = 0.0f}); //, .posZ = 0.5f, .padding = 0.0f });
+			for (uint32_t i = 0; i < corners; ++i)
+			{
+				uint32_t corner = i * cornerStep;
+				float angle = float(corner) * float(2.0f * M_PI) / float(AsteroidCorners);
+				float x = cos(angle);
+				float y = sin(angle);
+				float r = radiuses[ corner ];
+				vertices.emplace_back(GpuModelVertex{ .posX = x * r, .posY = y *r}); //, .posZ = 0.5f, .padding = 0.0f });
+				indices.emplace_back(0u);
+				indices.emplace_back(1u + i);
+				indices.emplace_back(1u + (i + 1u) % corners);
+			}
 
-		uint32_t startIndex = uint32_t(asteroidTypes << 8u);
-		vertices.emplace_back(GpuModelVertex{ .posX = 0.0f, .posY = 0.0f}); //, .posZ = 0.5f, .padding = 0.0f });
-		for (uint32_t i = 0; i < AsteroidCorners; ++i)
+			meshes.addMesh(vertices.data(), uint32_t(vertices.size()), indices.data(), uint32_t(indices.size()));
+		}
+	}
+
+	uint32_t playerMesh = 0u;
+	{
+		GpuModelVertex vertices[] = {
+			GpuModelVertex{ .posX = -1.0f, .posY = -1.0f},
+			GpuModelVertex{ .posX = 0.0f, .posY = 1.5f},
+			GpuModelVertex{ .posX = 1.0f, .posY = -1.0f},
+		};
+		uint32_t indices[] = { 0u, 1u, 2u };
+		playerMesh = meshes.addMesh(vertices, 3u, indices, 3u);
+	}
+
+	uint32_t projectileMesh = 0u;
+	{
+		GpuModelVertex vertices[] = {
+			GpuModelVertex{ .posX = 0.0f, .posY = -1.0f},
+			GpuModelVertex{ .posX = 1.0f, .posY = 0.0f},
+			GpuModelVertex{ .posX = 0.0f, .posY = 1.0f},
+			GpuModelVertex{ .posX = -1.0f, .posY = 0.0f},
+		};
+		uint32_t indices[] = { 0u, 1u, 2u, 0u, 2u, 3u };
+		projectileMesh = meshes.addMesh(vertices, 4u, indices, 6u);
+	}
+
+	if(!meshes.upload())
+	{
+		printf("Failed to upload meshes\n");
+		return;
+	}
+
+	// Every LOD level has room for all asteroids, inside it every shape has room for its asteroids.
+	// LOD mesh of shape s and lod l draws instances from l * AsteroidMaxTypes + start of shape s.
+	constexpr uint32_t AsteroidMaxTypes = 1000u;
+	constexpr uint32_t PlayerInstance = AsteroidMaxTypes * AsteroidLodCount;
+	// Live projectiles are packed after the player, they come and go every step so there are no fixed slots.
+	constexpr uint32_t ProjectileInstance = PlayerInstance + 1u;
+	constexpr uint32_t InstanceCount = ProjectileInstance + MaxProjectiles;
+	// Asteroids average about one overlap each, room for four so steady state frames never grow it.
+	collisionPairs.reserve(AsteroidMaxTypes * 4u);
+	std::vector<DrawElementsIndirectCommand> asteroidDraws;
+	std::vector<uint32_t> asteroidBaseInstances;
+	for(uint32_t shape = 0u; shape < AsteroidShapeCount; ++shape)
+	{
+		uint32_t start = shape * AsteroidMaxTypes / AsteroidShapeCount;
+		uint32_t end = (shape + 1u) * AsteroidMaxTypes / AsteroidShapeCount;
+		for(uint32_t lod = 0u; lod < AsteroidLodCount; ++lod)
 		{
-			float angle = float(i) * float(2.0f * M_PI) / float(AsteroidCorners);
-			float x = cos(angle);
-			float y = sin(angle);
-			float r = 0.8f + 0.2f * (float(rand()) / float(RAND_MAX));
-			vertices.emplace_back(GpuModelVertex{ .posX = x * r, .posY = y *r}); //, .posZ = 0.5f, .padding = 0.0f });
-			modelIndices.emplace_back(startIndex);
-			modelIndices.emplace_back((i + 1) % AsteroidCorners + startIndex);
-			modelIndices.emplace_back((i + 2) % AsteroidCorners + startIndex);
+			uint32_t baseInstance = lod * AsteroidMaxTypes + start;
+			asteroidDraws.push_back(meshes.getDrawCommand(shape * AsteroidLodCount + lod, baseInstance, end - start));
+			asteroidBaseInstances.push_back(baseInstance);
 		}
 
-		modelIndices.emplace_back(startIndex);
-		modelIndices.emplace_back(AsteroidCorners - 1u + startIndex);
-		modelIndices.emplace_back(1u + startIndex);
+		for(uint32_t asteroidTypes = start; asteroidTypes < end; ++asteroidTypes)
+		{
+			float xPos = float(rand()) / float(RAND_MAX) * WorldWidth;
+			float yPos = float(rand()) / float(RAND_MAX) * WorldHeight;
+			float size = 5.0f + 10.0f * float(rand()) / float(RAND_MAX);
+			float speedX = 20.0f * (float(rand()) / float(RAND_MAX) * 2.0f - 1.0f);
+			float speedY = 20.0f * (float(rand()) / float(RAND_MAX) * 2.0f - 1.0f);
+			float rotationSpeed = float(rand()) / float(RAND_MAX) * 2.0f - 1.0f;
+			entities.add(Entity{ .posX = xPos,  .posY = yPos, .posZ = 0.5f, .rotation = 0.0f, .speedX = speedX, .speedY = speedY, .size = size, .rotationSpeed = rotationSpeed },
+				core::getColor(0.5, 0.5, 0.5, 1.0f), shape * AsteroidLodCount);
+		}
 	}
 
+	// Player comes after the asteroids, found through its handle.
+	core::SlotHandle playerHandle;
 	{
 		float xPos = 200.0f;
 		float yPos = 200.0f;
 		float size = 10.0f;
-		entities.emplace_back(Entity{ .posX = xPos,  .posY = yPos, .posZ = 0.5f, .rotation = 0.0f, .speedX = 0.0f, .speedY = 0.0f, .size = size, .padding = 0.0f });
-
-		uint32_t pos = uint32_t((xPos / 2048.0f) * 65535.0f);
-		pos += uint32_t((yPos / 2048.0f) * 65535.0f) << 16u;
-		uint32_t sincossize = uint32_t((size / 64.0f) * 1023.0f);
-
-/*
-		modelInstances.emplace_back(GpuModelInstance{ .posX = xPos, .posY = yPos, 
-			//.posZ = 0.0f, .rotation = 0.0f, 
-			.sinRotation = 0.0f, .cosRotation = 0.0f,
-			.color = core::getColor(1.0f, 1.0f, 0.0f, 1.0f), .size = size,
-			.modelVertexStartIndex = uint32_t(vertices.size()), .modelIndiceCount = 3 });
-*/
-		modelInstances.emplace_back(GpuModelInstance{ .pos = pos, 
-				.sinCosRotSize = sincossize,
-				.color = core::getColor(1.0, 1.0, 0.0, 1.0f),
-			.modelVertexStartIndex = uint32_t(vertices.size()) });
-
-		vertices.emplace_back(GpuModelVertex{ .posX = -1.0f, .posY = -1.0f}); //, .posZ = 0.5f, .padding = 0.0f });
-		vertices.emplace_back(GpuModelVertex{ .posX = 0.0f, .posY = 1.5f});//, .posZ = 0.5f, .padding = 0.0f });
-		vertices.emplace_back(GpuModelVertex{ .posX = 1.0f, .posY = -1.0f});//, .posZ = 0.5f, .padding = 0.0f });
-		uint32_t startIndex = AsteroidMaxTypes << 8u;
-		modelIndices.emplace_back(0 + startIndex);
-		modelIndices.emplace_back(1 + startIndex);
-		modelIndices.emplace_back(2 + startIndex);
+		playerHandle = entities.add(Entity{ .posX = xPos,  .posY = yPos, .posZ = 0.5f, .rotation = 0.0f, .speedX = 0.0f, .speedY = 0.0f, .size = size, .rotationSpeed = 0.0f },
+			core::getColor(1.0, 1.0, 0.0, 1.0f), playerMesh);
 	}
 
+	// Cpu path picks LODs every frame, instance counts of the draws get written every frame.
+	std::vector<DrawElementsIndirectCommand> modelDraws(asteroidDraws);
+	modelDraws.push_back(meshes.getDrawCommand(playerMesh, PlayerInstance, 1u));
+	modelDraws.push_back(meshes.getDrawCommand(projectileMesh, ProjectileInstance, 0u));
+	uint32_t modelDrawCount = uint32_t(modelDraws.size());
+	ShaderBuffer modelDrawBuffer(GL_DRAW_INDIRECT_BUFFER, 
+		(modelDrawCount * uint32_t(sizeof(DrawElementsIndirectCommand)) + 15u) & ~15u, 0, nullptr, false, 3u);
+	std::vector<std::atomic<uint32_t>> asteroidInstanceCounts(asteroidDraws.size());
+	MeshInstanceBuckets asteroidBuckets{ .baseInstances = asteroidBaseInstances.data(), 
+		.instanceCounts = asteroidInstanceCounts.data(), .meshCount = uint32_t(asteroidDraws.size()) };
+	// Cpu path only, gpu path would have to read the counts back.
+	uint32_t visibleAsteroids = 0u;
+	// No camera zoom yet, world units are pixels.
+	const float pixelsPerUnit = 1.0f;
+
 	//GL_TEXTURE_BUFFER
 	//ShaderBuffer verticesBuffer(GL_SHADER_STORAGE_BUFFER, uint32_t(vertices.size() * sizeof(GpuModelVertex)), GL_STATIC_DRAW, vertices.data());
 	//ShaderBuffer indicesModels(GL_ELEMENT_ARRAY_BUFFER, uint32_t(modelIndices.size() * sizeof(uint32_t)), GL_STATIC_DRAW, modelIndices.data());
-	ShaderBuffer instanceDataBuffer(GL_SHADER_STORAGE_BUFFER, uint32_t(modelInstances.size() * sizeof(GpuModelInstance)), GL_DYNAMIC_DRAW, modelInstances.data());
-
-
-	ShaderBuffer verticesBuffer(GL_SHADER_STORAGE_BUFFER, uint32_t(vertices.size() * sizeof(GpuModelVertex)), 0, vertices.data(), true);
-	ShaderBuffer indicesModels(GL_ELEMENT_ARRAY_BUFFER, uint32_t(modelIndices.size() * sizeof(uint32_t)), 0, modelIndices.data(), true);
-	//ShaderBuffer instanceDataBuffer(GL_SHADER_STORAGE_BUFFER, uint32_t(modelInstances.size() * sizeof(GpuModelInstance)), 0, modelInstances.data(), true);
-
-	ShaderBuffer ssbo(GL_SHADER_STORAGE_BUFFER, 1024u * 16u, GL_DYNAMIC_COPY, nullptr);
-	
+	// Streaming, the render thread copies the instances of the frame packet in each frame.
+	ShaderBuffer instanceDataBuffer(GL_SHADER_STORAGE_BUFFER, InstanceCount * uint32_t(sizeof(GpuModelInstance)), 0, nullptr, false, 3u);
 
-	std::vector<uint32_t> quadIndices;
-	quadIndices.resize(6 * 1024);
-	for(int i = 0; i < 1024; ++i)
+	GpuAsteroidSimulation *gpuAsteroids = nullptr;
+	if(gpuSimulation)
 	{
-		quadIndices[size_t(i) * 6 + 0] = i * 4 + 0;
-		quadIndices[size_t(i) * 6 + 1] = i * 4 + 1;
-		quadIndices[size_t(i) * 6 + 2] = i * 4 + 2;
-
-		quadIndices[size_t(i) * 6 + 3] = i * 4 + 0;
-		quadIndices[size_t(i) * 6 + 4] = i * 4 + 2;
-		quadIndices[size_t(i) * 6 + 5] = i * 4 + 3;
+		gpuAsteroids = new GpuAsteroidSimulation(entities, AsteroidMaxTypes, asteroidDraws, InstanceCount);
+		if(!gpuAsteroids->init())
+		{
+			delete gpuAsteroids;
+			return;
+		}
 	}
+	//ShaderBuffer instanceDataBuffer(GL_SHADER_STORAGE_BUFFER, uint32_t(modelInstances.size() * sizeof(GpuModelInstance)), 0, modelInstances.data(), true);
 
+	// Text stays in the buffer, only changed glyphs get uploaded.
+	TextBuffer textBuffer(1024u);
+	TextBlocks textBlocks;
+	textBlocks.metrics = textBuffer.addBlock(32u, 100.0f, 400.0f, core::getColor(0.0f, 1.0f, 0.0f, 1.0f));
+	textBlocks.text = textBuffer.addBlock(1024u - 32u, 100.0f, 100.0f, core::getColor(0.0f, 1.0f, 0.0f, 1.0f));
+	
 
+	// Meshes bind their own indices into this, quads and text go through the batcher.
 	unsigned int VAO;
 	glGenVertexArrays(1, &VAO);
 
-	glBindVertexArray(VAO);
-
-	ShaderBuffer indexBufferQuads(GL_ELEMENT_ARRAY_BUFFER, uint32_t(quadIndices.size() * sizeof(uint32_t)), GL_STATIC_DRAW,	quadIndices.data());
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferQuads.handle);
-
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indicesModels.handle);
-	//glEnableVertexAttribArray(0);  
-
-	std::vector<GPUVertexData> vertData;
-
+	RenderCommandBuffer frameCommands;
+	GlStateCache glState;
+	QuadBatcher uiBatcher;
+	uint64_t uiTextKey = QuadBatcher::getSortKey(1u, uiBatcher.addShader(shaderTexture), 0u, QuadBatcher::BlendAlpha);
 
 
 	std::string txt = "Hiiohoi";
 
 
-	uint32_t texHandle = 0;
-
-	{
-		std::vector<uint8_t> fontPic;
-		fontPic.resize((128-32) * 8 * 12 * 4);
-
-		// Note save order is a bit messed up!!! Since the file has one char 8x12 then next
-		uint32_t index = 0;
-		for(int y = 0; y < 12; ++y)
-		{
-			for(int charIndex = 0; charIndex < 128 - 32; ++charIndex)
-			{
-				uint8_t p = data[y + size_t(charIndex) * 12];
-				for(int x = 0; x < 8; ++x)
-				{
-					uint8_t bitColor = uint8_t((p >> x) & 1) * 255;
-					fontPic[size_t(index) * 4 + 0] = bitColor;
-					fontPic[size_t(index) * 4 + 1] = bitColor;
-					fontPic[size_t(index) * 4 + 2] = bitColor;
-					fontPic[size_t(index) * 4 + 3] = bitColor;
-
-					++index;
-				}
-			}
-		}
-		const int textureWidth = 8*(128-32);
-		const int textureHeight = 12;
-
-		glGenTextures(1, &texHandle);
-		glBindTexture(GL_TEXTURE_2D, texHandle);
-		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, textureWidth, textureHeight);
-		
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_BGRA, GL_UNSIGNED_BYTE, fontPic.data());
-	}
+	// Font bits are read straight from the ssbo in fragment shader.
+	FontBuffer fontBuffer(font.getGlyphData(fontSize), font.getGlyphDataSize(fontSize));
 
 
 
 
 
 	Cursor cursor;
-	updateText(txt, vertData, cursor);
+	textBuffer.setText(textBlocks.text, txt);
+	updateText(textBuffer, textBlocks, cursor);
 
 	SDL_Event event;
 	bool quit = false;
@@ -346,17 +355,129 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 	bool keysDown[ 255 ] = {};
 
 
-	uint32_t queries[2 * 4] = {0, 0};
-	glGenQueries(2 * 4, queries);
-	for(uint32_t i = 2; i < 8; ++i)
-		glQueryCounter(queries[i], GL_TIMESTAMP);
-	
-	uint32_t queryIndex = 0;
-	while (!quit)
+	const char *gpuTimerNames[] = { "frame", "models", "ui", "simulation" };
+	GpuTimerPool gpuTimers(uint32_t(sizeof(gpuTimerNames) / sizeof(gpuTimerNames[ 0 ])));
+	uint32_t gpuTimerFrame = gpuTimers.addScope(gpuTimerNames[ 0 ]);
+	uint32_t gpuTimerModels = gpuTimers.addScope(gpuTimerNames[ 1 ]);
+	uint32_t gpuTimerUi = gpuTimers.addScope(gpuTimerNames[ 2 ]);
+	uint32_t gpuTimerSimulation = gpuTimers.addScope(gpuTimerNames[ 3 ]);
+
+	// 200 steps per second, at most 8 steps per frame. Longer frames slow the simulation down.
+	core::FixedTimestep timestep(0.005f, 8u);
+
+	// Simulation of the next frame runs while the render thread submits and swaps the last one.
+	FramePacket packets[ 2 ];
+	for(FramePacket &packet : packets)
+	{
+		packet.instances.resize(InstanceCount);
+		packet.modelDraws = modelDraws;
+	}
+
+	auto renderPacket = [&](uint32_t packetIndex)
 	{
+		FramePacket &packet = packets[ packetIndex ];
+		float windowWidth = float(packet.windowWidth);
+		float windowHeight = float(packet.windowHeight);
+
+		//Clear color buffer
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		gpuTimers.beginFrame();
+		gpuTimers.beginScope(gpuTimerFrame);
+
+		// Every pass is recorded and submitted inside its timer scope, state cache drops the binds that
+		// stayed the same from the last pass or frame.
+		glState.resetStats();
+		frameCommands.setViewport(uint32_t(packet.windowWidth), uint32_t(packet.windowHeight));
+		uint32_t modelDrawOffset = 0u;
+		if(gpuAsteroids)
+		{
+			// Asteroids stay on gpu, only the player and projectiles go up.
+			gpuAsteroids->updateInstances(PlayerInstance, 1u + packet.projectileCount,
+				packet.instances.data() + PlayerInstance);
+
+			gpuTimers.beginScope(gpuTimerSimulation);
+			gpuAsteroids->update(frameCommands, timestep.stepDt, packet.simulationSteps, packet.alpha, pixelsPerUnit,
+				windowWidth, windowHeight, WorldWidth, WorldHeight);
+			frameCommands.submit(glState);
+			gpuTimers.endScope(gpuTimerSimulation);
+		}
+		else
+		{
+			uint32_t instanceOffset = 0u;
+			uint32_t instanceBytes = (ProjectileInstance + packet.projectileCount) * uint32_t(sizeof(GpuModelInstance));
+			memcpy(instanceDataBuffer.allocate(instanceBytes, instanceOffset), packet.instances.data(), instanceBytes);
+
+			uint32_t drawBytes = modelDrawCount * uint32_t(sizeof(DrawElementsIndirectCommand));
+			memcpy(modelDrawBuffer.allocate(drawBytes, modelDrawOffset), packet.modelDraws.data(), drawBytes);
+		}
+
+		// "Model rendering"
+		{
+			gpuTimers.beginScope(gpuTimerModels);
+			frameCommands.setProgram(modelShader);
+			frameCommands.setUniform2f(0, windowWidth, windowHeight);
+
+			frameCommands.setVertexArray(VAO);
+			meshes.bind(frameCommands, 1);
+			if(gpuAsteroids)
+			{
+				frameCommands.bindStorage(2, gpuAsteroids->instanceBuffer);
+				gpuAsteroids->drawAsteroids(frameCommands, meshes);
+				meshes.drawMesh(frameCommands, playerMesh, PlayerInstance, 1u);
+				if(packet.projectileCount > 0u)
+					meshes.drawMesh(frameCommands, projectileMesh, ProjectileInstance, packet.projectileCount);
+			}
+			else
+			{
+				frameCommands.bindStorage(2, instanceDataBuffer);
+				meshes.drawIndirect(frameCommands, modelDrawBuffer.handle, modelDrawOffset, modelDrawCount);
+			}
+			frameCommands.submit(glState);
+			gpuTimers.endScope(gpuTimerModels);
+		}
+		// UI
+
+		{
+			gpuTimers.beginScope(gpuTimerUi);
+			frameCommands.bindStorage(1, fontBuffer.buffer);
+			uiBatcher.addText(uiTextKey, textBuffer);
+			uiBatcher.flush(frameCommands, windowWidth, windowHeight);
+			frameCommands.submit(glState);
+			gpuTimers.endScope(gpuTimerUi);
+		}
+		gpuTimers.endScope(gpuTimerFrame);
+		gpuTimers.endFrame();
+		instanceDataBuffer.endFrame();
+		modelDrawBuffer.endFrame();
+		uiBatcher.endFrame();
+
+		packet.gpuFrameMs = gpuTimers.getScopeTime(gpuTimerFrame);
+		packet.gpuModelsMs = gpuTimers.getScopeTime(gpuTimerModels);
+		packet.gpuUiMs = gpuTimers.getScopeTime(gpuTimerUi);
+		packet.glCalls = glState.issuedCalls;
+		packet.skippedGlCalls = glState.skippedCalls;
+	};
+	core::RenderThread renderThread;
+	if(!renderThread.start(app, 2u, renderPacket))
+	{
+		delete gpuAsteroids;
+		return;
+	}
+
+	// Per frame temporaries, reset after the frame packet is submitted.
+	core::FrameArena frameArena;
+	core::FrameAllocationCheck allocationCheck(app.benchmarkFrames > 0u);
+
+	while (!quit && !app.isBenchmarkDone())
+	{
+		FramePacket &packet = packets[ renderThread.beginPacket() ];
+
 		lastStamp = nowStamp;
 		nowStamp = SDL_GetPerformanceCounter();
 		dt = float(( nowStamp - lastStamp ) * 1000 / freq / 1000.0);
+		if(app.benchmarkFrames > 0u)
+			dt = app.fixedDt;
 
 		while (SDL_PollEvent(&event))
 		{
@@ -398,6 +519,10 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 						}
 						break;
 
+						case SDLK_SPACE:
+							keysDown[ 3 ] = true;
+							break;
+
 						default:
 							break;
 					}
@@ -433,6 +558,10 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 						}
 						break;
 
+						case SDLK_SPACE:
+							keysDown[ 3 ] = false;
+							break;
+
 
 						default:
 							break;
@@ -451,34 +580,44 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 			}
 		}
 
-		Entity &playerEntity = entities[ AsteroidMaxTypes ];
+		uint32_t simulationSteps = timestep.advance(dt);
+		InterpolationParams interpolation{ .alpha = timestep.getAlpha(), .wrapWidth = WorldWidth, .wrapHeight = WorldHeight };
+
+		uint32_t playerIndex = entities.getIndex(playerHandle);
+		Entity playerEntity = entities.get(playerIndex);
+		float playerPrevX = entities.prevPosX[ playerIndex ];
+		float playerPrevY = entities.prevPosY[ playerIndex ];
+		float playerPrevRotation = entities.prevRotation[ playerIndex ];
 
 		float updateDur = 0.0f;
-		float dtSplit = dt;
 		{
 			Uint64 timer1 = SDL_GetPerformanceCounter();
-			// Update position, definitely not accurate physics, if dt is big this doesn't work properly, trying to split it into several updates.
-			while (dtSplit > 0.0f)
+			// Update position, definitely not accurate physics, steps are fixed size so results don't depend on frame times.
+			for(uint32_t step = 0; step < simulationSteps; ++step)
 			{
-				float dddt = fminf(dtSplit, 0.005f);
+				float stepDt = timestep.stepDt;
+				playerPrevX = playerEntity.posX;
+				playerPrevY = playerEntity.posY;
+				playerPrevRotation = playerEntity.rotation;
+
 				float origSpeed = sqrtf(playerEntity.speedX * playerEntity.speedX + playerEntity.speedY * playerEntity.speedY);
 
 				if (keysDown[ 1 ])
 				{
 					float rotSpeed = fminf(origSpeed, 1.0f);
 					rotSpeed = rotSpeed * 2.0f + ( 1.0f - rotSpeed ) * 5.0f;
-					playerEntity.rotation += rotSpeed * dddt;
+					playerEntity.rotation += rotSpeed * stepDt;
 				}
 				if (keysDown[ 2 ])
 				{
 					float rotSpeed = fminf(origSpeed, 1.0f);
 					rotSpeed = rotSpeed * 2.0f + ( 1.0f - rotSpeed ) * 5.0f;
-					playerEntity.rotation -= rotSpeed * dddt;
+					playerEntity.rotation -= rotSpeed * stepDt;
 				}
 				if (keysDown[ 0 ])
 				{
-					playerEntity.speedX += cosf(playerEntity.rotation + float(M_PI) * 0.5f) * 1000.0f * dddt;
-					playerEntity.speedY += sinf(playerEntity.rotation + float(M_PI) * 0.5f) * 1000.0f * dddt;
+					playerEntity.speedX += cosf(playerEntity.rotation + float(M_PI) * 0.5f) * 1000.0f * stepDt;
+					playerEntity.speedY += sinf(playerEntity.rotation + float(M_PI) * 0.5f) * 1000.0f * stepDt;
 				}
 
 
@@ -486,167 +625,175 @@ static void mainProgramLoop(core::App &app, std::vector<char> &data, std::string
 
 				{
 					float origSpeed = sqrtf(playerEntity.speedX * playerEntity.speedX + playerEntity.speedY * playerEntity.speedY);
-					float dec = dddt * 0.5f * origSpeed;
+					float dec = stepDt * 0.5f * origSpeed;
 					float speed = fmax(origSpeed - dec, 0.0f);
 					float slowDown = origSpeed > 0.1f ? speed / origSpeed : 0.0f;
 					playerEntity.speedX *= slowDown;
 					playerEntity.speedY *= slowDown;
 
-					playerEntity.posX += playerEntity.speedX * dddt;
-					playerEntity.posY += playerEntity.speedY * dddt;
+					playerEntity.posX += playerEntity.speedX * stepDt;
+					playerEntity.posY += playerEntity.speedY * stepDt;
 				}
 
+				// Player wraps around the window, not the world, so snap instead of interpolating across it.
+				while(playerEntity.posX > app.windowWidth)
+				{
+					playerEntity.posX -= app.windowWidth;
+					playerPrevX = playerEntity.posX;
+				}
+				while(playerEntity.posX < 0.0f)
+				{
+					playerEntity.posX += app.windowWidth;
+					playerPrevX = playerEntity.posX;
+				}
+				while(playerEntity.posY > app.windowHeight)
+				{
+					playerEntity.posY -= app.windowHeight;
+					playerPrevY = playerEntity.posY;
+				}
+				while(playerEntity.posY < 0.0f)
+				{
+					playerEntity.posY += app.windowHeight;
+					playerPrevY = playerEntity.posY;
+				}
 
-				dtSplit -= dddt;
-			}
-
-			while(playerEntity.posX > app.windowWidth)
-			{
-				playerEntity.posX -= app.windowWidth;
-			}
-			while(playerEntity.posX < 0.0f)
-			{
-				playerEntity.posX += app.windowWidth;
-			}
-			while(playerEntity.posY > app.windowHeight)
-			{
-				playerEntity.posY -= app.windowHeight;
-			}
-			while(playerEntity.posY < 0.0f)
-			{
-				playerEntity.posY += app.windowHeight;
-			}
+				uint64_t stepIndex = timestep.stepIndex - simulationSteps + step;
+				for(uint32_t i = projectiles.getCount(); i > 0u; --i)
+				{
+					// Last projectile moves into the hole, it was already checked.
+					if(projectileExpireSteps[ i - 1u ] <= stepIndex)
+					{
+						projectiles.removeAt(i - 1u);
+						projectileExpireSteps[ i - 1u ] = projectileExpireSteps.back();
+						projectileExpireSteps.pop_back();
+					}
+				}
+				integrateEntities(projectiles, 0u, projectiles.getCount(), stepDt, 1u, WorldWidth, WorldHeight);
 
-			for (uint32_t i = 0; i < modelInstances.size(); ++i)
-			{
-				uint32_t pos = uint32_t((entities[ i ].posX / 2048.0f) * 65535.0f);
-				pos += uint32_t((entities[ i ].posY / 2048.0f) * 65535.0f) << 16u;
-				uint32_t sincossize = uint32_t((entities[ i ].size / 64.0f) * 1023.0f);
-				float sinv = sinf(entities[ i ].rotation);
-				float cosv = cosf(entities[ i ].rotation);
-				sincossize += uint32_t((sinv * 0.5f + 0.5f) * 1023.0f) << 10u;
-				sincossize += uint32_t((cosv * 0.5f + 0.5f) * 1023.0f) << 20u;
-
-
-				modelInstances[ i ].pos = pos;
-				modelInstances[ i ].sinCosRotSize = sincossize;
-				/*
-				modelInstances[ i ].posX = entities[ i ].posX;
-				modelInstances[ i ].posY = entities[ i ].posY;
-				modelInstances[ i ].sinRotation = sinf(entities[ i ].rotation);
-				modelInstances[ i ].cosRotation = cosf(entities[ i ].rotation);
-				//modelInstances[ i ].posZ = entities[ i ].posZ;
-				//modelInstances[ i ].rotation = entities[ i ].rotation;
-				*/
+				for(uint32_t i = 0; i < ProjectilesPerStep && keysDown[ 3 ] && projectiles.getCount() < MaxProjectiles; ++i)
+				{
+					float angle = playerEntity.rotation + float(M_PI) * 0.5f + (float(i) - float(ProjectilesPerStep - 1u) * 0.5f) * 0.1f;
+					float dirX = cosf(angle);
+					float dirY = sinf(angle);
+					projectiles.add(Entity{ .posX = playerEntity.posX + dirX * playerEntity.size, 
+						.posY = playerEntity.posY + dirY * playerEntity.size, .posZ = 0.5f, .rotation = angle, 
+						.speedX = playerEntity.speedX + dirX * ProjectileSpeed, .speedY = playerEntity.speedY + dirY * ProjectileSpeed,
+						.size = ProjectileSize, .rotationSpeed = 0.0f }, core::getColor(1.0f, 0.5f, 0.0f, 1.0f), projectileMesh);
+					projectileExpireSteps.push_back(stepIndex + ProjectileLifeSteps);
+				}
 			}
-			Uint64 timer2 = SDL_GetPerformanceCounter();
-			updateDur = float(( timer2 - timer1 ) * 1000 / freq / 1000.0);
-		}
-		//Clear color buffer
-		glClear(GL_COLOR_BUFFER_BIT);
 
-		glQueryCounter(queries[queryIndex], GL_TIMESTAMP);
-			
-		modelShader.useProgram();
-		instanceDataBuffer.updateBuffer(0, uint32_t(modelInstances.size() * sizeof(GpuModelInstance)), modelInstances.data());
+			entities.set(playerIndex, playerEntity);
+			entities.prevPosX[ playerIndex ] = playerPrevX;
+			entities.prevPosY[ playerIndex ] = playerPrevY;
+			entities.prevRotation[ playerIndex ] = playerPrevRotation;
 
-		
-		// "Model rendering"
-		{
-			modelShader.useProgram();
-			glUniform2f(0, GLfloat(app.windowWidth), GLfloat(app.windowHeight));
-
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indicesModels.handle);
-			verticesBuffer.bind(1);
-			instanceDataBuffer.bind(2);
-			glDrawElements(GL_TRIANGLES, GLsizei(modelIndices.size()), GL_UNSIGNED_INT, 0);
-			verticesBuffer.unbind();
-			instanceDataBuffer.unbind();
-		}
-		// UI
-
-		{
-			shaderTexture.useProgram();
-			glUniform2f(0, GLfloat(app.windowWidth), GLfloat(app.windowHeight));
-
-			ssbo.updateBuffer(0, uint32_t(vertData.size() * sizeof(GPUVertexData)), vertData.data());
-			ssbo.bind(0);
-			//		glDrawArrays(GL_TRIANGLES, 0, 6);
-			glBindVertexArray(VAO);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferQuads.handle);
-
-			glBindTexture(GL_TEXTURE_2D, texHandle);
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			GpuModelInstance *instanceData = packet.instances.data();
+			instanceData[ PlayerInstance ] = packModelInstance(entities, playerIndex, interpolation);
+			packModelInstances(projectiles, 0u, projectiles.getCount(), interpolation, instanceData + ProjectileInstance);
+			packet.projectileCount = projectiles.getCount();
 
+			if(!gpuAsteroids)
+			{
+				for(std::atomic<uint32_t> &instanceCount : asteroidInstanceCounts)
+					instanceCount = 0u;
+
+				// Only asteroids overlapping the window get uploaded and drawn.
+				CullRect cullRect{ .minX = 0.0f, .minY = 0.0f, .maxX = float(app.windowWidth), .maxY = float(app.windowHeight) };
+				ModelFrameParams frameParams{ .stepDt = timestep.stepDt, .stepCount = simulationSteps,
+					.wrapWidth = WorldWidth, .wrapHeight = WorldHeight, .interpolation = interpolation,
+					.cullRect = cullRect, .pixelsPerUnit = pixelsPerUnit,
+					.visibleIndices = frameArena.allocateArray<uint32_t>(entities.getCount()),
+					.packedInstances = frameArena.allocateArray<GpuModelInstance>(entities.getCount()),
+					.buckets = &asteroidBuckets, .outInstances = instanceData };
+
+				// Entities are independent of each other, so every batch can move, cull, pack and bucket its own range.
+				// Batch size is multiple of 8 so SIMD packing sees same groups as in single threaded run, and small
+				// enough that the asteroids spread over the workers. hellogl_bench checks the results match.
+				jobSystem.parallelFor(AsteroidMaxTypes, 128u, [&](uint32_t start, uint32_t end)
+				{
+					updateModelBatch(entities, start, end, frameParams);
+				});
 
-			glDrawElements(GL_TRIANGLES, GLsizei(vertData.size() * 6), GL_UNSIGNED_INT, 0);
+				DrawElementsIndirectCommand *draws = packet.modelDraws.data();
+				visibleAsteroids = 0u;
+				for(uint32_t i = 0; i < modelDrawCount; ++i)
+				{
+					draws[ i ] = modelDraws[ i ];
+					if(i < asteroidInstanceCounts.size())
+					{
+						draws[ i ].instanceCount = asteroidInstanceCounts[ i ];
+						visibleAsteroids += draws[ i ].instanceCount;
+					}
+				}
+				draws[ modelDrawCount - 1u ].instanceCount = packet.projectileCount;
 
-			ssbo.unbind();
-		}
-		glQueryCounter(queries[queryIndex + 1], GL_TIMESTAMP);
-		SDL_GL_SwapWindow(app.window);
-		SDL_Delay(1);
-		float gpuDuration = 0.0f;
-		
-		{
-			int done = 0;
-			uint32_t qlast = (queryIndex + 6) % 8;
-			while(!done)
-			{
-				glGetQueryObjectiv(queries[qlast + 0], GL_QUERY_RESULT_AVAILABLE, &done);
-			}
-			done = 0;
-			while(!done)
-			{
-				glGetQueryObjectiv(queries[qlast + 1], GL_QUERY_RESULT_AVAILABLE, &done);
+				// Broad phase only for now, pairs are not resolved yet.
+				collisionPairs.clear();
+				collisionGrid.build(entities.posX.data(), entities.posY.data(), entities.size.data(), entities.getCount(),
+					WorldWidth, WorldHeight, MaxEntityRadius * 2.0f);
+				collisionGrid.findPairs(collisionPairs);
 			}
 
-			GLuint64 startTime = 0;
-			GLuint64 endTime = 0;
-			glGetQueryObjectui64v(queries[qlast + 0], GL_QUERY_RESULT, &startTime);
-			glGetQueryObjectui64v(queries[qlast + 1], GL_QUERY_RESULT, &endTime);
-			
-			gpuDuration = float(double(endTime - startTime) / 1000000.0);
-	
+			Uint64 timer2 = SDL_GetPerformanceCounter();
+			updateDur = float(( timer2 - timer1 ) * 1000 / freq / 1000.0);
 		}
-		
-		char str[100];
-		sprintf(str, "%2.2fms, fps: %4.2f, update: %2.3fms, gpu: %2.3fms", 
-			dt * 1000.0f, 1.0f / dt, updateDur * 1000.0f, gpuDuration);
-		SDL_SetWindowTitle(app.window, str);
-
-		queryIndex = (queryIndex + 2) % 8;
+		packet.simulationSteps = simulationSteps;
+		packet.alpha = interpolation.alpha;
+		packet.windowWidth = app.windowWidth;
+		packet.windowHeight = app.windowHeight;
+
+		// Gpu times and call counts are from the last time the render thread had this packet.
+		const char *title = frameArena.format("%2.2fms, fps: %4.2f, update: %2.3fms, gpu: %2.3fms, models: %2.3fms, ui: %2.3fms, pairs: %u, gl calls: %u, skipped: %u, projectiles: %u", 
+			dt * 1000.0f, 1.0f / dt, updateDur * 1000.0f, packet.gpuFrameMs, packet.gpuModelsMs, packet.gpuUiMs,
+			uint32_t(collisionPairs.size()), packet.glCalls, packet.skippedGlCalls, packet.projectileCount);
+		if(!gpuAsteroids)
+			title = frameArena.format("%s, visible: %u, culled: %u", title, visibleAsteroids, AsteroidMaxTypes - visibleAsteroids);
+		renderThread.submitPacket();
+		SDL_SetWindowTitle(app.window, title);
+		frameArena.reset();
+		allocationCheck.endFrame();
 
 		//printf("Frame duration: %f fps: %f\n", dt, 1000.0f / dt);
 	}
+
+	// Gpu simulation buffers get deleted on this thread.
+	renderThread.stop();
+	delete gpuAsteroids;
 }
 
 int main(int argCount, char **argv) 
 {
-	std::vector<char> data;
-	std::string filename;
-	if(argCount < 2)
-	{
-		filename = "assets/font/new_font.dat";
-	}
-	else
+	core::App app;
+	argCount = app.parseArguments(argCount, argv);
+
+	core::FontFile font;
+	std::string filename = "assets/font/new_font.dat";
+	bool gpuSimulation = false;
+	for(int i = 1; i < argCount; ++i)
 	{
-		filename = argv[1];
+		// Moves, culls and compacts asteroids with compute shader.
+		if(strcmp(argv[i], "--gpu-sim") == 0)
+			gpuSimulation = true;
+		else
+			filename = argv[i];
 	}
 	
-	if(core::loadFontData(filename, data))
+	uint32_t fontSize = font.open(core::getVfs().getFile(filename)) ? font.findSize(8u, 12u) : ~0u;
+	if(fontSize != ~0u && font.getSize(fontSize).firstChar != 32u)
+		fontSize = ~0u;
+
+	if(fontSize != ~0u)
 	{
-		core::App app;
 		if(app.init("OpenGL 4.5, render font", SCREEN_WIDTH, SCREEN_HEIGHT))
 		{
 			app.setVsyncEnabled(true);
-			mainProgramLoop(app, data, filename);
+			mainProgramLoop(app, font, fontSize, filename, gpuSimulation);
 		}
 	}
 	else
 	{
-		printf("Failed to load file: %s\n", filename.c_str());
+		printf("Failed to load 8x12 font from file: %s\n", filename.c_str());
 	}
 	
 	return 0;